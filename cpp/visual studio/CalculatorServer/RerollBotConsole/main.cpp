@@ -143,6 +143,8 @@ int main(int argc, char** argv) {
 		int i = 1;
 
 		std::string screenshot_path;
+		// detect geometry at this screenshot height, 0 for the native resolution
+		int geometry_height = 0;
 		while (i < argc)
 		{
 			if (std::strcmp(argv[i], "-v") == 0)
@@ -155,6 +157,11 @@ int main(int argc, char** argv) {
 				screenshot_path = argv[i + 1];
 				i += 2;
 			}
+			else if (std::strcmp(argv[i], "-n") == 0)
+			{
+				geometry_height = std::stoi(argv[i + 1]);
+				i += 2;
+			}
 			else
 				i++;
 		}
@@ -163,6 +170,7 @@ int main(int argc, char** argv) {
 
 		std::cout << "Initializing ...";
 		image_recognition recog(verbose);
+		recog.set_geometry_height(geometry_height);
 		trading_menu reader(recog);
 		item_wishlist wishlist(recog, "RerollbotConfig.json");
 		std::cout << "Done" << std::endl;
@@ -202,11 +210,23 @@ int main(int argc, char** argv) {
 
 		};
 
+		// skips the frames while the menu opens or the offerings render in
+		auto take_stable_screenshot = [&]()
+		{
+			frame::ptr screenshot = frame::create(take_screenshot());
+			for (int i = 1; i < stability_gate::MAX_CAPTURES && !reader.is_stable(wishlist.get_language(), screenshot); i++)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(stability_gate::CAPTURE_INTERVAL_MS));
+				screenshot = frame::create(take_screenshot());
+			}
+			return screenshot;
+		};
+
 		int counter = 0;
 
 		while (true)
 		{
-			reader.update(wishlist.get_language(), take_screenshot());
+			reader.update(wishlist.get_language(), take_stable_screenshot());
 			unsigned int trader = reader.get_open_trader();
 
 			if (trader && reader.has_reroll() &&
@@ -294,7 +314,7 @@ int main(int argc, char** argv) {
 						auto purchase_iter = purchase_candidates.begin();
 						for (; purchase_iter != purchase_candidates.end(); ++purchase_iter)
 						{
-							reader.update(wishlist.get_language(), take_screenshot());
+							reader.update(wishlist.get_language(), take_stable_screenshot());
 							if (reader.is_ship_full())
 							{
 								if (verbose)
@@ -8,9 +8,14 @@
 
 
 #include <chrono>
+#include <functional>
 #include <iostream>
 
+#include <opencv2/imgproc.hpp>
+
+#include "reader_binarization.hpp"
 #include "reader_statistics.hpp"
+#include "reader_trading.hpp"
 
 using namespace reader;
 
@@ -27,10 +32,161 @@ void print(const std::map<unsigned int, T>& map,
 	}
 }
 
+const std::vector<std::string> statistics_screenshots = {
+	"test_screenshots/stat_finance_global_1.png",
+	"test_screenshots/stat_finance_global_2_16_10.jpg",
+	"test_screenshots/stat_pop_global_3_16_10.jpg",
+	"test_screenshots/stat_pop_island_1.png",
+	"test_screenshots/stat_pop_island_2.png",
+	"test_screenshots/stat_pop_island_3.png",
+	"test_screenshots/stat_pop_island_4.png",
+	"test_screenshots/stat_pop_island_5.png",
+	"test_screenshots/stat_pop_island_6.png",
+	"test_screenshots/stat_prod_global_1.png",
+	"test_screenshots/stat_prod_global_2.png",
+	"test_screenshots/stat_prod_global_3_16_10.jpg",
+	"test_screenshots/stat_prod_island_6.png"
+};
+
+const std::vector<std::string> trading_screenshots = {
+	"test_screenshots/trading_eli_1.png",
+	"test_screenshots/trading_hugo_1.png",
+	"test_screenshots/trading_kahina_2.png",
+	"test_screenshots/trading_kahina_3.png",
+	"test_screenshots/trading_kahina_4.png",
+	"test_screenshots/trading_sarmento_1.png"
+};
+
+// table panes of the statistics screen that are split into rows
+const std::vector<std::pair<std::string, cv::Rect2f>> table_panes = {
+	{ "islands", statistics_screen_params::pane_islands },
+	{ "finance center", statistics_screen_params::pane_finance_center },
+	{ "finance right", statistics_screen_params::pane_finance_right },
+	{ "production center", statistics_screen_params::pane_production_center },
+	{ "production right", statistics_screen_params::pane_production_right },
+	{ "population center", statistics_screen_params::pane_population_center }
+};
+
+/*
+* Prints the table panes of @param{path} whose separator lines differ between
+* line_detection::HOUGH and line_detection::PROJECTION. Returns the number of differences.
+*/
+int compare_line_detection(const std::string& path)
+{
+	frame::ptr img = frame::create(image_recognition::load_image(path));
+	int differences = 0;
+
+	for (const auto& entry : table_panes)
+	{
+		cv::Mat pane = image_recognition::get_pane(entry.second, img->get_cropped());
+		std::vector<int> hough = image_recognition::find_horizontal_lines(pane, 0.75f, image_recognition::line_detection::HOUGH);
+		std::vector<int> projection = image_recognition::find_horizontal_lines(pane, 0.75f, image_recognition::line_detection::PROJECTION);
+		if (hough == projection)
+			continue;
+
+		differences++;
+		std::cout << path << " [LINES] " << entry.first << " hough:";
+		for (int line : hough)
+			std::cout << " " << line;
+		std::cout << " projection:";
+		for (int line : projection)
+			std::cout << " " << line;
+		std::cout << std::endl;
+	}
+
+	return differences;
+}
+
+/*
+* Prints the table panes of @param{img} whose separator lines differ between the native
+* resolution and geometry detection at 1080 rows. Returns the number of differences.
+*/
+int compare_normalized_lines(image_recognition& recog, const std::string& name, const cv::Mat& img)
+{
+	frame::ptr screenshot = frame::create(img);
+	recog.update("english", screenshot->size());
+	recog.set_geometry_height(1080);
+	int differences = 0;
+
+	for (const auto& entry : table_panes)
+	{
+		cv::Mat pane = image_recognition::get_pane(entry.second, screenshot->get_cropped());
+		std::vector<int> native = image_recognition::find_horizontal_lines(pane);
+		std::vector<int> normalized = recog.find_horizontal_lines_normalized(pane);
+		if (native == normalized)
+			continue;
+
+		differences++;
+		std::cout << name << " [LINES] " << entry.first << " native:";
+		for (int line : native)
+			std::cout << " " << line;
+		std::cout << " normalized:";
+		for (int line : normalized)
+			std::cout << " " << line;
+		std::cout << std::endl;
+	}
+
+	recog.set_geometry_height(0);
+	return differences;
+}
+
+/*
+* Average duration of @param{f} over @param{runs} runs in milliseconds
+*/
+double measure_time(const std::function<void()>& f, int runs = 20)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < runs; i++)
+		f();
+	auto end = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double, std::milli> duration = end - start;
+	return duration.count() / runs;
+}
+
+/*
+* Times gray conversion, Otsu's threshold and thresholding with binarization
+* against cv::cvtColor and cv::threshold on @param{img} and checks that both
+* produce identical pixels. Returns false on any difference.
+*/
+bool benchmark_binarization(const std::string& name, const cv::Mat& img)
+{
+	cv::Mat gray_cv, binary_cv, gray, binary;
+	double threshold_cv = 0;
+	int threshold = 0;
+
+	double time_cv = measure_time([&]()
+		{
+			cv::cvtColor(img, gray_cv, cv::COLOR_BGRA2GRAY);
+			threshold_cv = cv::threshold(gray_cv, binary_cv, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+		});
+
+	double time = measure_time([&]()
+		{
+			binarization::histogram hist;
+			binarization::to_gray(img, gray, &hist);
+			threshold = binarization::otsu_threshold(hist);
+			binarization::threshold(gray, binary, threshold, false);
+		});
+
+	bool identical = static_cast<int>(threshold_cv) == threshold &&
+		!cv::countNonZero(gray != gray_cv) &&
+		!cv::countNonZero(binary != binary_cv);
+
+	std::cout << name << " " << img.cols << "x" << img.rows
+		<< " [BINARIZATION] opencv: " << time_cv << " ms, fused: " << time << " ms, "
+		<< (identical ? "identical" : "DIFFERENT") << std::endl;
+
+	return identical;
+}
+
 void unit_tests(image_recognition& recog, statistics& image_recog)
 {
 	auto start = std::chrono::high_resolution_clock::now();
+	bool passed = true;
 
+	// compare the batched and cascaded reads with their reference while the screenshots are evaluated
+	recog.clear_result_caches();
+	recog.enable_parity_checks(true);
 
 	auto test_image = [&](const std::string& language, const std::string& path, std::map<unsigned int, statistics_screen::properties> expected)
 	{
@@ -246,7 +402,66 @@ void unit_tests(image_recognition& recog, statistics& image_recog)
 	}
 
 
-	std::cout << "all tests passed!" << std::endl;
+	// the offerings search the icons of all items
+	trading_menu trade(recog);
+	for (const std::string& path : trading_screenshots)
+	{
+		trade.update("english", image_recognition::load_image(path));
+		trade.get_offerings();
+	}
+
+	// line_detection::PROJECTION may only become the default if this reports no differences
+	int line_differences = 0;
+	for (const std::string& path : statistics_screenshots)
+		line_differences += compare_line_detection(path);
+	std::cout << "line detection differences: " << line_differences << std::endl;
+	if (line_differences)
+		passed = false;
+
+	// there is no 4K screenshot, the 1440p one is scaled up
+	cv::Mat img_1080 = image_recognition::load_image("test_screenshots/pop_global_bright_1920.png");
+	cv::Mat img_1440 = image_recognition::load_image("test_screenshots/stat_prod_global_1.png");
+	cv::Mat img_2160;
+	cv::resize(img_1440, img_2160, cv::Size(3840, 2160), 0, 0, cv::INTER_CUBIC);
+
+	// geometry detection at 1080 rows must find the same rows as the native resolution
+	int normalized_differences = compare_normalized_lines(recog, "stat_prod_global_1 scaled", img_2160);
+	for (const std::string& path : statistics_screenshots)
+	{
+		cv::Mat img = image_recognition::load_image(path);
+		if (img.rows > 1080)
+			normalized_differences += compare_normalized_lines(recog, path, img);
+	}
+	std::cout << "normalized line differences: " << normalized_differences << std::endl;
+	if (normalized_differences)
+		passed = false;
+
+	bool binarization_identical = benchmark_binarization("pop_global_bright_1920", img_1080);
+	binarization_identical &= benchmark_binarization("stat_prod_global_1", img_1440);
+	binarization_identical &= benchmark_binarization("stat_prod_global_1 scaled", img_2160);
+	if (!binarization_identical)
+	{
+		std::cout << "binarization differs from OpenCV" << std::endl;
+		passed = false;
+	}
+
+	// the glyph recognizer must take over from Tesseract for numbers it has learned from the screenshots
+	const cache_statistics digit_statistics = recog.get_cache_statistics().at("digits");
+	std::cout << "numbers read without Tesseract: " << digit_statistics.hits << " of " << digit_statistics.hits + digit_statistics.misses << std::endl;
+	if (!digit_statistics.hits)
+		passed = false;
+
+	const auto parity = recog.get_parity_statistics();
+	for (const auto& entry : parity)
+		std::cout << entry.first << " parity: " << entry.second.mismatches << " of " << entry.second.checks << " differ" << std::endl;
+	recog.enable_parity_checks(false);
+	if (parity.at("icons").mismatches || parity.at("cells").mismatches || parity.at("boxes").mismatches)
+		passed = false;
+
+	if (passed)
+		std::cout << "all tests passed!" << std::endl;
+	else
+		std::cout << "tests failed!" << std::endl;
 
 	auto end = std::chrono::high_resolution_clock::now();
 	std::chrono::duration<double, std::milli> duration = end - start;
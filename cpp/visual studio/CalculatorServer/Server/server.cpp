@@ -19,14 +19,28 @@ server::server(bool verbose)
 {
 }
 
-server::server(bool verbose, std::wstring window_regex, utility::string_t url) :
+server::server(bool verbose, std::wstring window_regex, utility::string_t url, int geometry_height) :
 	recog(verbose, image_recognition::to_string(window_regex)),
 	stats(recog),
 	m_listener(url)
 {
+	recog.set_geometry_height(geometry_height);
 	m_listener.support(methods::GET, std::bind(&server::handle_get, this, std::placeholders::_1));
 }
 
+reader::frame::ptr server::capture_stable_frame(const cv::Rect2i& window, const std::string& language)
+{
+	frame::ptr screenshot = frame::create(recog.take_screenshot(window));
+
+	for (int i = 1; i < stability_gate::MAX_CAPTURES && !stats.is_stable(language, screenshot); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(stability_gate::CAPTURE_INTERVAL_MS));
+		screenshot = frame::create(recog.take_screenshot(window));
+	}
+
+	return screenshot;
+}
+
 
 void server::repack_statistics(web::json::value& result, bool optimal_productivity)
 {
@@ -121,8 +135,8 @@ void server::handle_get(http_request request)
 				return;
 			}
 
-			cv::Mat screenshot(recog.take_screenshot(window));
-			stats.update(language, screenshot);
+			// intermediate frames of a tab switch would be read as garbage
+			stats.update(language, capture_stable_frame(window, language));
 
 			web::json::value json_message;
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <thread>
 
 
 #include "cpprest/json.h"
@@ -17,7 +18,10 @@ class server
 {
 public:
 	server(bool verbose);
-	server(bool verbose, std::wstring window_regex, utility::string_t url);
+	/*
+	* @param{geometry_height} see image_recognition::set_geometry_height
+	*/
+	server(bool verbose, std::wstring window_regex, utility::string_t url, int geometry_height = 0);
 
 	pplx::task<void> open() { return m_listener.open(); }
 	pplx::task<void> close() { return m_listener.close(); }
@@ -30,6 +34,12 @@ private:
 
 	void handle_get(http_request message);
 
+	/*
+	* Captures @param{window} until the statistics screen is not animated,
+	* at most stability_gate::MAX_CAPTURES times
+	*/
+	reader::frame::ptr capture_stable_frame(const cv::Rect2i& window, const std::string& language);
+
 	reader::image_recognition recog;
 	reader::statistics stats;
 	http_listener m_listener;
@@ -33,7 +33,7 @@ using namespace experimental::listener;
 
 std::unique_ptr<server> g_http;
 
-void on_initialize(bool verbose, std::wstring window_regex, const string_t& address)
+void on_initialize(bool verbose, std::wstring window_regex, const string_t& address, int geometry_height)
 {
 	// Build our listener's URI from the configured address and the hard-coded path "MyServer/Action"
 
@@ -41,7 +41,7 @@ void on_initialize(bool verbose, std::wstring window_regex, const string_t& addr
 	uri.append_path(U("AnnoServer/Population"));
 
 	auto addr = uri.to_uri().to_string();
-	g_http = std::make_unique<server>(verbose, window_regex, addr);
+	g_http = std::make_unique<server>(verbose, window_regex, addr, geometry_height);
 	try {
 		g_http->open().wait();
 	}
@@ -86,6 +86,8 @@ int wmain(int argc, wchar_t* argv[])
 	bool verbose = false;
 	std::wstring window_regex;
 	std::wstring hostname;
+	// detect geometry at this screenshot height, 0 for the native resolution
+	int geometry_height = 0;
 
 	int i = 1;
 	while (i < argc)
@@ -109,6 +111,11 @@ int wmain(int argc, wchar_t* argv[])
 			hostname = argv[i + 1];
 			i += 2;
 		}
+		else if (std::wcscmp(argv[i], U("-n")) == 0)
+		{
+			geometry_height = std::stoi(argv[i + 1]);
+			i += 2;
+		}
 		else
 			i++;
 	}
@@ -120,7 +127,7 @@ int wmain(int argc, wchar_t* argv[])
 	address.append(port);
 
 	try {
-		on_initialize(verbose, window_regex, address);
+		on_initialize(verbose, window_regex, address, geometry_height);
 		std::cout << "Press ENTER to exit." << std::endl;
 
 		std::string line;
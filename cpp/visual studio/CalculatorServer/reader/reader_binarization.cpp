@@ -0,0 +1,261 @@
+#include "reader_binarization.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define READER_BINARIZATION_SSE2
+#endif
+
+namespace reader
+{
+
+////////////////////////////////////////
+//
+// Class: binarization
+//
+////////////////////////////////////////
+
+void binarization::to_gray(const cv::Mat& input, cv::Mat& gray, histogram* hist)
+{
+	if (input.empty() || input.channels() == 1)
+	{
+		gray = input;
+		if (hist)
+			compute_histogram(gray, *hist);
+		return;
+	}
+
+	cv::Mat output(input.size(), CV_8UC1);
+	const int channels = input.channels();
+
+	// four partial histograms avoid stalls on consecutive equal values
+	std::vector<std::uint32_t> partial(hist ? 4 * 256 : 0, 0);
+
+	for (int y = 0; y < input.rows; y++)
+	{
+		const unsigned char* src = input.ptr<unsigned char>(y);
+		unsigned char* dst = output.ptr<unsigned char>(y);
+
+		if (channels == 4)
+			bgra_row_to_gray(src, dst, input.cols);
+		else
+			for (int x = 0; x < input.cols; x++)
+				dst[x] = static_cast<unsigned char>((src[3 * x] * B2Y + src[3 * x + 1] * G2Y + src[3 * x + 2] * R2Y + (1 << (SHIFT - 1))) >> SHIFT);
+
+		// the row is still in the cache
+		if (hist)
+		{
+			int x = 0;
+			for (; x + 4 <= input.cols; x += 4)
+			{
+				partial[dst[x]]++;
+				partial[256 + dst[x + 1]]++;
+				partial[512 + dst[x + 2]]++;
+				partial[768 + dst[x + 3]]++;
+			}
+			for (; x < input.cols; x++)
+				partial[dst[x]]++;
+		}
+	}
+
+	if (hist)
+		for (int i = 0; i < 256; i++)
+			(*hist)[i] = partial[i] + partial[256 + i] + partial[512 + i] + partial[768 + i];
+
+	gray = output;
+}
+
+void binarization::compute_histogram(const cv::Mat& gray, histogram& hist)
+{
+	hist.fill(0);
+	for (int y = 0; y < gray.rows; y++)
+	{
+		const unsigned char* row = gray.ptr<unsigned char>(y);
+		for (int x = 0; x < gray.cols; x++)
+			hist[row[x]]++;
+	}
+}
+
+int binarization::otsu_threshold(const histogram& hist)
+{
+	// same arithmetic as OpenCV, so that ties are resolved identically
+	double total = 0;
+	double mu = 0;
+	for (int i = 0; i < 256; i++)
+	{
+		total += hist[i];
+		mu += i * static_cast<double>(hist[i]);
+	}
+
+	if (!total)
+		return 0;
+
+	const double scale = 1. / total;
+	mu *= scale;
+
+	double mu1 = 0, q1 = 0;
+	double max_sigma = 0;
+	int max_val = 0;
+
+	for (int i = 0; i < 256; i++)
+	{
+		double p_i = hist[i] * scale;
+		mu1 *= q1;
+		q1 += p_i;
+		double q2 = 1. - q1;
+
+		if (std::min(q1, q2) < FLT_EPSILON || std::max(q1, q2) > 1. - FLT_EPSILON)
+			continue;
+
+		mu1 = (mu1 + i * p_i) / q1;
+		double mu2 = (mu - q1 * mu1) / q2;
+		double sigma = q1 * q2 * (mu1 - mu2) * (mu1 - mu2);
+		if (sigma > max_sigma)
+		{
+			max_sigma = sigma;
+			max_val = i;
+		}
+	}
+
+	return max_val;
+}
+
+void binarization::threshold(const cv::Mat& gray, cv::Mat& output, int threshold, bool invert)
+{
+	threshold = std::max(-1, std::min(255, threshold));
+
+	output.create(gray.size(), CV_8UC1);
+	for (int y = 0; y < gray.rows; y++)
+		threshold_row(gray.ptr<unsigned char>(y), output.ptr<unsigned char>(y), gray.cols, threshold, invert);
+}
+
+int binarization::binarize(const cv::Mat& input, cv::Mat& output, bool invert, int threshold)
+{
+	if (input.empty())
+	{
+		output = cv::Mat();
+		return threshold;
+	}
+
+	cv::Mat gray;
+	if (threshold < 0)
+	{
+		histogram hist;
+		to_gray(input, gray, &hist);
+		threshold = otsu_threshold(hist);
+	}
+	else
+		to_gray(input, gray);
+
+	// gray input is shared, never threshold it in place
+	if (gray.data == output.data)
+		output = cv::Mat();
+
+	binarization::threshold(gray, output, threshold, invert);
+	return threshold;
+}
+
+cv::Mat binarization::binarize_channels(const cv::Mat& input)
+{
+	if (input.empty())
+		return cv::Mat();
+
+	const int channels = input.channels();
+	unsigned char min[3] = { 255, 255, 255 };
+	unsigned char max[3] = { 0, 0, 0 };
+
+	for (int y = 0; y < input.rows; y++)
+	{
+		const unsigned char* src = input.ptr<unsigned char>(y);
+		for (int x = 0; x < input.cols; x++, src += channels)
+			for (int c = 0; c < 3; c++)
+			{
+				min[c] = std::min(min[c], src[c]);
+				max[c] = std::max(max[c], src[c]);
+			}
+	}
+
+	// cv::threshold rounds the threshold down for 8 bit images
+	int thresholds[3];
+	for (int c = 0; c < 3; c++)
+		thresholds[c] = (min[c] + max[c]) / 2;
+
+	cv::Mat output(input.size(), CV_8UC3);
+	for (int y = 0; y < input.rows; y++)
+	{
+		const unsigned char* src = input.ptr<unsigned char>(y);
+		unsigned char* dst = output.ptr<unsigned char>(y);
+		for (int x = 0; x < input.cols; x++, src += channels, dst += 3)
+			for (int c = 0; c < 3; c++)
+				dst[c] = src[c] > thresholds[c] ? 255 : 0;
+	}
+
+	return output;
+}
+
+void binarization::bgra_row_to_gray(const unsigned char* src, unsigned char* dst, int width)
+{
+	int x = 0;
+
+#ifdef READER_BINARIZATION_SSE2
+	const __m128i coefficients = _mm_setr_epi16(B2Y, G2Y, R2Y, 0, B2Y, G2Y, R2Y, 0);
+	const __m128i round = _mm_set1_epi32(1 << (SHIFT - 1));
+	const __m128i zero = _mm_setzero_si128();
+
+	// gray values of four pixels as 32 bit integers
+	auto gray_4 = [&](const unsigned char* pixels)
+	{
+		__m128i bgra = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels));
+		// (b * B2Y + g * G2Y, r * R2Y) for two pixels each
+		__m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(bgra, zero), coefficients);
+		__m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(bgra, zero), coefficients);
+		lo = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));
+		hi = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+		__m128i sums = _mm_unpacklo_epi64(_mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 1, 2, 0)),
+			_mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 1, 2, 0)));
+		return _mm_srli_epi32(_mm_add_epi32(sums, round), SHIFT);
+	};
+
+	for (; x + 16 <= width; x += 16)
+	{
+		const unsigned char* pixels = src + 4 * x;
+		__m128i words_lo = _mm_packs_epi32(gray_4(pixels), gray_4(pixels + 16));
+		__m128i words_hi = _mm_packs_epi32(gray_4(pixels + 32), gray_4(pixels + 48));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(words_lo, words_hi));
+	}
+#endif
+
+	for (; x < width; x++)
+		dst[x] = static_cast<unsigned char>((src[4 * x] * B2Y + src[4 * x + 1] * G2Y + src[4 * x + 2] * R2Y + (1 << (SHIFT - 1))) >> SHIFT);
+}
+
+void binarization::threshold_row(const unsigned char* src, unsigned char* dst, int width, int threshold, bool invert)
+{
+	const unsigned char above = invert ? 0 : 255;
+	const unsigned char below = invert ? 255 : 0;
+	int x = 0;
+
+#ifdef READER_BINARIZATION_SSE2
+	if (threshold >= 0)
+	{
+		// unsigned comparison through the signed one by flipping the sign bits
+		const __m128i sign = _mm_set1_epi8(static_cast<char>(0x80));
+		const __m128i limit = _mm_set1_epi8(static_cast<char>(threshold ^ 0x80));
+		const __m128i flip = invert ? _mm_set1_epi8(static_cast<char>(0xff)) : _mm_setzero_si128();
+
+		for (; x + 16 <= width; x += 16)
+		{
+			__m128i values = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x)), sign);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_xor_si128(_mm_cmpgt_epi8(values, limit), flip));
+		}
+	}
+#endif
+
+	for (; x < width; x++)
+		dst[x] = src[x] > threshold ? above : below;
+}
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <opencv2/core/mat.hpp>
+
+namespace reader
+{
+
+/*
+* Fused kernels to convert 8 bit BGRA images to gray and threshold them.
+* Results equal cv::cvtColor(COLOR_BGRA2GRAY) and cv::threshold (with THRESH_OTSU)
+* but the conversion and the histogram are computed in one pass over the input
+* and no temporary images are allocated.
+*/
+class binarization
+{
+public:
+	typedef std::array<std::uint32_t, 256> histogram;
+
+	/*
+	* Converts @param{input} (BGRA, BGR or gray) to gray and accumulates the
+	* gray values in @param{hist} if it is not null.
+	* Gray input is returned without copy.
+	*/
+	static void to_gray(const cv::Mat& input, cv::Mat& gray, histogram* hist = nullptr);
+
+	static void compute_histogram(const cv::Mat& gray, histogram& hist);
+
+	/*
+	* Threshold chosen by Otsu's method, same as cv::threshold with THRESH_OTSU
+	*/
+	static int otsu_threshold(const histogram& hist);
+
+	/*
+	* Sets pixels > @param{threshold} to 255 and all others to 0, swapped if @param{invert}.
+	* @param{output} may be @param{gray}.
+	*/
+	static void threshold(const cv::Mat& gray, cv::Mat& output, int threshold, bool invert);
+
+	/*
+	* Converts @param{input} to gray and thresholds it with @param{threshold},
+	* uses Otsu's threshold if @param{threshold} < 0. Returns the threshold used.
+	*/
+	static int binarize(const cv::Mat& input, cv::Mat& output, bool invert = false, int threshold = -1);
+
+	/*
+	* Thresholds each of the first three channels of @param{input} (BGR or BGRA)
+	* halfway between the minimum and maximum of that channel.
+	* Returns an image with three channels.
+	*/
+	static cv::Mat binarize_channels(const cv::Mat& input);
+
+private:
+	// fixed point coefficients of cv::cvtColor for 8 bit images (RY15, GY15, BY15 in OpenCV)
+	static const int SHIFT = 15;
+	static const int B2Y = 3735;
+	static const int G2Y = 19235;
+	static const int R2Y = 9798;
+
+	static void bgra_row_to_gray(const unsigned char* src, unsigned char* dst, int width);
+	static void threshold_row(const unsigned char* src, unsigned char* dst, int width, int threshold, bool invert);
+};
+
+}
@@ -0,0 +1,133 @@
+#include "reader_change_detection.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace reader
+{
+
+////////////////////////////////////////
+//
+// Class: tile_change_detector
+//
+////////////////////////////////////////
+
+std::uint64_t tile_change_detector::update(const cv::Mat& image)
+{
+	generation++;
+
+	if (image.size() != size)
+	{
+		size = image.size();
+		tiles_x = (size.width + TILE_SIZE - 1) / TILE_SIZE;
+		tiles_y = (size.height + TILE_SIZE - 1) / TILE_SIZE;
+		hashes.assign(tiles_x * tiles_y, 0);
+		changed.assign(tiles_x * tiles_y, generation);
+	}
+
+	const cv::Rect bounds(0, 0, size.width, size.height);
+	for (int ty = 0; ty < tiles_y; ty++)
+		for (int tx = 0; tx < tiles_x; tx++)
+		{
+			cv::Rect tile = cv::Rect(tx * TILE_SIZE, ty * TILE_SIZE, TILE_SIZE, TILE_SIZE) & bounds;
+			std::uint64_t hash = hash_rows(image.ptr<unsigned char>(tile.y) + tile.x * image.elemSize(), image.step, tile.width * image.elemSize(), tile.height);
+
+			std::size_t index = ty * tiles_x + tx;
+			if (hash != hashes[index])
+			{
+				hashes[index] = hash;
+				changed[index] = generation;
+			}
+		}
+
+	return generation;
+}
+
+bool tile_change_detector::changed_since(const cv::Rect& region, std::uint64_t generation) const
+{
+	if (!generation || hashes.empty())
+		return true;
+
+	cv::Rect clipped = region & cv::Rect(0, 0, size.width, size.height);
+	if (clipped.empty())
+		return region.area() > 0;
+
+	for (int ty = clipped.y / TILE_SIZE; ty <= (clipped.br().y - 1) / TILE_SIZE; ty++)
+		for (int tx = clipped.x / TILE_SIZE; tx <= (clipped.br().x - 1) / TILE_SIZE; tx++)
+			if (changed[ty * tiles_x + tx] > generation)
+				return true;
+
+	return false;
+}
+
+std::uint64_t tile_change_detector::get_generation() const
+{
+	return generation;
+}
+
+void tile_change_detector::clear()
+{
+	size = cv::Size();
+	tiles_x = tiles_y = 0;
+	hashes.clear();
+	changed.clear();
+}
+
+std::uint64_t tile_change_detector::hash_rows(const unsigned char* data, std::size_t step, std::size_t row_bytes, int rows)
+{
+	// the lanes are independent, so their multiplications overlap in the pipeline
+	std::uint64_t v1 = PRIME_1 + PRIME_2;
+	std::uint64_t v2 = PRIME_2;
+	std::uint64_t v3 = 0;
+	std::uint64_t v4 = 0 - PRIME_1;
+	std::uint64_t tail = PRIME_5;
+
+	for (int y = 0; y < rows; y++, data += step)
+	{
+		std::size_t x = 0;
+		for (; x + 32 <= row_bytes; x += 32)
+		{
+			v1 = mix_lane(v1, read_64(data + x));
+			v2 = mix_lane(v2, read_64(data + x + 8));
+			v3 = mix_lane(v3, read_64(data + x + 16));
+			v4 = mix_lane(v4, read_64(data + x + 24));
+		}
+
+		for (; x < row_bytes; x++)
+			tail = rotate_left(tail ^ data[x] * PRIME_5, 11) * PRIME_1;
+	}
+
+	std::uint64_t hash = rotate_left(v1, 1) + rotate_left(v2, 7) + rotate_left(v3, 12) + rotate_left(v4, 18);
+	hash = (hash ^ mix_lane(0, v1)) * PRIME_1 + PRIME_4;
+	hash = (hash ^ mix_lane(0, v2)) * PRIME_1 + PRIME_4;
+	hash = (hash ^ mix_lane(0, v3)) * PRIME_1 + PRIME_4;
+	hash = (hash ^ mix_lane(0, v4)) * PRIME_1 + PRIME_4;
+	hash ^= tail + row_bytes * rows;
+
+	// avalanche
+	hash ^= hash >> 33;
+	hash *= PRIME_2;
+	hash ^= hash >> 29;
+	hash *= PRIME_3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+std::uint64_t tile_change_detector::rotate_left(std::uint64_t x, int bits)
+{
+	return x << bits | x >> (64 - bits);
+}
+
+std::uint64_t tile_change_detector::read_64(const unsigned char* data)
+{
+	std::uint64_t value;
+	std::memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+std::uint64_t tile_change_detector::mix_lane(std::uint64_t accumulator, std::uint64_t input)
+{
+	return rotate_left(accumulator + input * PRIME_2, 31) * PRIME_1;
+}
+
+}
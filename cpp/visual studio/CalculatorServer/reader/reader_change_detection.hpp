@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+namespace reader
+{
+
+/*
+* Splits consecutive frames into tiles of TILE_SIZE x TILE_SIZE pixels and
+* hashes them to tell which regions changed. Every call to update() starts a
+* new generation, results read from a frame can be reused as long as none of
+* the tiles they depend on changed after the generation they were read in.
+*/
+class tile_change_detector
+{
+public:
+	/*
+	* Hashes the tiles of @param{image} and returns the new generation.
+	* All tiles count as changed if the size differs from the previous image.
+	*/
+	std::uint64_t update(const cv::Mat& image);
+
+	/*
+	* Tests whether a tile overlapping @param{region} changed after @param{generation}.
+	* Generation 0 is older than all frames.
+	*/
+	bool changed_since(const cv::Rect& region, std::uint64_t generation) const;
+
+	std::uint64_t get_generation() const;
+
+	/*
+	* Forgets all tiles, the next frame counts as changed everywhere
+	*/
+	void clear();
+
+	/*
+	* 64 bit hash of @param{rows} rows of @param{row_bytes} bytes, @param{step} bytes apart,
+	* computed with four independent multiply-rotate lanes like xxHash64
+	*/
+	static std::uint64_t hash_rows(const unsigned char* data, std::size_t step, std::size_t row_bytes, int rows);
+
+	static const int TILE_SIZE = 64;
+
+private:
+	cv::Size size;
+	int tiles_x = 0;
+	int tiles_y = 0;
+	std::vector<std::uint64_t> hashes;
+	// generation in which each tile changed last
+	std::vector<std::uint64_t> changed;
+	std::uint64_t generation = 0;
+
+	// constants of xxHash64
+	static const std::uint64_t PRIME_1 = 11400714785074694791ull;
+	static const std::uint64_t PRIME_2 = 14029467366897019727ull;
+	static const std::uint64_t PRIME_3 = 1609587929392839161ull;
+	static const std::uint64_t PRIME_4 = 9650029242287828579ull;
+	static const std::uint64_t PRIME_5 = 2870177450012600261ull;
+
+	static std::uint64_t rotate_left(std::uint64_t x, int bits);
+	static std::uint64_t read_64(const unsigned char* data);
+	static std::uint64_t mix_lane(std::uint64_t accumulator, std::uint64_t input);
+};
+
+}
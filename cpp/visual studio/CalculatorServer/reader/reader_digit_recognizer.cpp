@@ -0,0 +1,293 @@
+#include "reader_digit_recognizer.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+#include <opencv2/imgproc.hpp>
+
+#include "reader_icon_hash.hpp"
+
+namespace reader
+{
+
+////////////////////////////////////////
+//
+// Class: digit_recognizer
+//
+////////////////////////////////////////
+
+const std::string digit_recognizer::CHARACTERS = "0123456789,./%+-";
+const std::string digit_recognizer::DIGITS = "0123456789";
+const std::string digit_recognizer::PERCENTAGES = "0123456789%";
+const std::string digit_recognizer::FRACTIONS = "0123456789/";
+
+bool digit_recognizer::recognize(const cv::Mat& img, std::string& text, const std::string& characters) const
+{
+	std::vector<glyph> glyphs;
+	if (!is_complete(characters) || !segment(img, glyphs))
+	{
+		statistics.misses++;
+		return false;
+	}
+
+	std::string result;
+	for (const glyph& g : glyphs)
+	{
+		unsigned int best = std::numeric_limits<unsigned int>::max();
+		unsigned int second = std::numeric_limits<unsigned int>::max();
+		char character = 0;
+
+		for (const glyph& t : templates)
+		{
+			if (t.confirmations < MIN_CONFIRMATIONS)
+				continue;
+
+			unsigned int d = distance(g, t);
+			if (d < best)
+			{
+				if (t.character != character)
+					second = best;
+				best = d;
+				character = t.character;
+			}
+			else if (d < second && t.character != character)
+			{
+				second = d;
+			}
+		}
+
+		if (best > MAX_DISTANCE || second < best + MIN_MARGIN)
+		{
+			statistics.misses++;
+			return false;
+		}
+
+		result.push_back(character);
+	}
+
+	statistics.hits++;
+	text = result;
+	return true;
+}
+
+void digit_recognizer::learn(const cv::Mat& img, const std::string& text)
+{
+	std::string characters;
+	for (char c : text)
+	{
+		if (c == ' ')
+			continue;
+		if (CHARACTERS.find(c) == std::string::npos)
+			return;
+		characters.push_back(c);
+	}
+
+	std::vector<glyph> glyphs;
+	if (characters.empty() || !segment(img, glyphs) || glyphs.size() != characters.size())
+		return;
+
+	for (std::size_t i = 0; i < glyphs.size(); i++)
+		glyphs[i].character = characters[i];
+
+	// the read must agree with the recognizer on every glyph
+	for (const glyph& g : glyphs)
+		for (const glyph& t : templates)
+			if (t.character != g.character && t.confirmations >= MIN_CONFIRMATIONS && distance(g, t) <= MAX_DISTANCE)
+				return;
+
+	// unconfirmed templates contradicted by this read were misread
+	templates.erase(std::remove_if(templates.begin(), templates.end(), [&](const glyph& t)
+		{
+			if (t.confirmations >= MIN_CONFIRMATIONS)
+				return false;
+
+			for (const glyph& g : glyphs)
+				if (t.character != g.character && distance(g, t) <= MAX_DISTANCE)
+					return true;
+			return false;
+		}), templates.end());
+
+	// each template is confirmed at most once per read
+	std::vector<bool> confirmed(templates.size(), false);
+	for (const glyph& g : glyphs)
+	{
+		std::size_t count = 0;
+		std::size_t nearest = templates.size();
+		unsigned int nearest_distance = std::numeric_limits<unsigned int>::max();
+		for (std::size_t j = 0; j < templates.size(); j++)
+		{
+			if (templates[j].character != g.character)
+				continue;
+
+			count++;
+			unsigned int d = distance(g, templates[j]);
+			if (d < nearest_distance)
+			{
+				nearest = j;
+				nearest_distance = d;
+			}
+		}
+
+		if (nearest_distance <= MAX_DISTANCE / 2)
+		{
+			if (!confirmed[nearest])
+				templates[nearest].confirmations++;
+			confirmed[nearest] = true;
+		}
+		else if (count < MAX_TEMPLATES_PER_CHARACTER)
+		{
+			templates.push_back(g);
+			templates.back().confirmations = 1;
+			confirmed.push_back(true);
+		}
+	}
+}
+
+bool digit_recognizer::is_complete(const std::string& characters) const
+{
+	for (char c : characters)
+		if (std::none_of(templates.begin(), templates.end(), [c](const glyph& t)
+			{
+				return t.character == c && t.confirmations >= MIN_CONFIRMATIONS;
+			}))
+			return false;
+
+	return true;
+}
+
+cache_statistics digit_recognizer::get_statistics() const
+{
+	cache_statistics result = statistics;
+	result.size = templates.size();
+	return result;
+}
+
+std::size_t digit_recognizer::size() const
+{
+	return templates.size();
+}
+
+void digit_recognizer::clear()
+{
+	templates.clear();
+}
+
+bool digit_recognizer::segment(const cv::Mat& img, std::vector<glyph>& glyphs)
+{
+	if (img.empty())
+		return false;
+
+	cv::Mat gray;
+	if (img.channels() == 4)
+		cv::cvtColor(img, gray, cv::COLOR_BGRA2GRAY);
+	else if (img.channels() == 3)
+		cv::cvtColor(img, gray, cv::COLOR_BGR2GRAY);
+	else
+		gray = img;
+
+	// only binarized images can be segmented reliably, the text is the minority color
+	int black = 0;
+	for (int y = 0; y < gray.rows; y++)
+	{
+		const unsigned char* row = gray.ptr<unsigned char>(y);
+		for (int x = 0; x < gray.cols; x++)
+		{
+			if (row[x] == 0)
+				black++;
+			else if (row[x] != 255)
+				return false;
+		}
+	}
+
+	cv::Mat mask;
+	if (2 * black <= gray.rows * gray.cols)
+		cv::compare(gray, 0, mask, cv::CMP_EQ);
+	else
+		cv::compare(gray, 255, mask, cv::CMP_EQ);
+
+	// columns containing text
+	std::vector<bool> filled(mask.cols, false);
+	for (int y = 0; y < mask.rows; y++)
+	{
+		const unsigned char* row = mask.ptr<unsigned char>(y);
+		for (int x = 0; x < mask.cols; x++)
+			if (row[x])
+				filled[x] = true;
+	}
+
+	std::vector<cv::Rect> boxes;
+	for (int x = 0; x < mask.cols; x++)
+	{
+		if (!filled[x])
+			continue;
+
+		int end = x;
+		while (end < mask.cols && filled[end])
+			end++;
+
+		int top = mask.rows, bottom = -1;
+		for (int y = 0; y < mask.rows; y++)
+		{
+			const unsigned char* row = mask.ptr<unsigned char>(y);
+			if (std::find_if(row + x, row + end, [](unsigned char v) { return v != 0; }) != row + end)
+			{
+				top = std::min(top, y);
+				bottom = y;
+			}
+		}
+
+		boxes.emplace_back(x, top, end - x, bottom - top + 1);
+		x = end;
+	}
+
+	if (boxes.empty() || boxes.size() > MAX_GLYPHS)
+		return false;
+
+	int line_top = mask.rows, line_bottom = 0;
+	for (const cv::Rect& box : boxes)
+	{
+		line_top = std::min(line_top, box.y);
+		line_bottom = std::max(line_bottom, box.y + box.height);
+	}
+	int line_height = line_bottom - line_top;
+
+	glyphs.clear();
+	for (const cv::Rect& box : boxes)
+	{
+		cv::Mat scaled;
+		cv::resize(mask(box), scaled, cv::Size(GLYPH_WIDTH, GLYPH_HEIGHT), 0, 0, cv::INTER_AREA);
+
+		glyph g{};
+		for (int y = 0; y < GLYPH_HEIGHT; y++)
+		{
+			const unsigned char* row = scaled.ptr<unsigned char>(y);
+			for (int x = 0; x < GLYPH_WIDTH; x++)
+				if (row[x] >= 64)
+				{
+					int bit = y * GLYPH_WIDTH + x;
+					g.bits[bit / 64] |= std::uint64_t(1) << (bit % 64);
+				}
+		}
+
+		g.top = (box.y - line_top) * 8 / line_height;
+		g.bottom = (box.y + box.height - line_top) * 8 / line_height;
+		glyphs.push_back(g);
+	}
+
+	return true;
+}
+
+unsigned int digit_recognizer::distance(const glyph& a, const glyph& b)
+{
+	// glyphs at a different height (e.g. comma and 9) never match
+	if (std::abs(a.top - b.top) > 1 || std::abs(a.bottom - b.bottom) > 1)
+		return std::numeric_limits<unsigned int>::max();
+
+	unsigned int result = 0;
+	for (int i = 0; i < WORDS; i++)
+		result += icon_hash_index::popcount(a.bits[i] ^ b.bits[i]);
+	return result;
+}
+
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+#include "reader_lru_cache.hpp"
+
+namespace reader
+{
+
+/*
+* Reads numbers rendered in the fixed UI font without Tesseract.
+* Glyphs are separated by empty columns of a binarized image, scaled to
+* GLYPH_WIDTH x GLYPH_HEIGHT bits and compared against glyph templates by Hamming distance.
+* The templates are learned from texts that were read by Tesseract before.
+* A template is only used once MIN_CONFIRMATIONS reads of different images agree
+* on it. A field is only recognized once every character it can contain has a
+* confirmed template, so that the true character of a glyph is always a candidate.
+* Separators and signs need not be listed: they are lower than digits, so their
+* glyphs never match a digit, and number_from_string discards them.
+*/
+class digit_recognizer
+{
+public:
+	static const int GLYPH_WIDTH = 12;
+	static const int GLYPH_HEIGHT = 16;
+	static const int WORDS = (GLYPH_WIDTH * GLYPH_HEIGHT + 63) / 64;
+
+	// a glyph is accepted if its nearest template is closer than MAX_DISTANCE bits
+	// and all templates of other characters are at least MIN_MARGIN bits further away
+	static const unsigned int MAX_DISTANCE = 16;
+	static const unsigned int MIN_MARGIN = 12;
+	static const std::size_t MAX_TEMPLATES_PER_CHARACTER = 16;
+	static const std::size_t MAX_GLYPHS = 24;
+	static const unsigned int MIN_CONFIRMATIONS = 2;
+
+	// characters that can be learned
+	static const std::string CHARACTERS;
+	// characters of plain numbers, percentages and fractions, see recognize
+	static const std::string DIGITS;
+	static const std::string PERCENTAGES;
+	static const std::string FRACTIONS;
+
+	/*
+	* Reads the single line of text in @param{img} (black and white, BGRA or gray).
+	* @param{characters} are the characters the field can contain.
+	* Returns false and leaves @param{text} unchanged if the image is not binary,
+	* not all @param{characters} are learned yet or any glyph cannot be classified with confidence.
+	*/
+	bool recognize(const cv::Mat& img, std::string& text, const std::string& characters = CHARACTERS) const;
+
+	/*
+	* Adds the glyphs in @param{img} as templates for the characters in @param{text}
+	* or confirms existing ones. Ignored unless all characters of @param{text} (spaces excluded)
+	* are in CHARACTERS and their number equals the number of glyphs.
+	* A read is rejected if a glyph is closer than MAX_DISTANCE to a confirmed template
+	* of another character, i.e. unless it agrees with the recognizer. Unconfirmed templates
+	* of other characters that close are dropped, they stem from a misread.
+	*/
+	void learn(const cv::Mat& img, const std::string& text);
+
+	/*
+	* Whether every character in @param{characters} has a confirmed template
+	*/
+	bool is_complete(const std::string& characters = CHARACTERS) const;
+
+	/*
+	* Returns the images read by recognize (hits) and those it rejected (misses)
+	*/
+	cache_statistics get_statistics() const;
+
+	std::size_t size() const;
+	void clear();
+
+private:
+	struct glyph
+	{
+		std::array<std::uint64_t, WORDS> bits;
+		// top and bottom relative to the line, in eighths of its height
+		int top;
+		int bottom;
+		char character;
+		// number of reads of different images that yielded this template
+		unsigned int confirmations;
+	};
+
+	/*
+	* Splits @param{img} into glyphs, returns false if it is not a binary image
+	*/
+	static bool segment(const cv::Mat& img, std::vector<glyph>& glyphs);
+
+	static unsigned int distance(const glyph& a, const glyph& b);
+
+	std::vector<glyph> templates;
+	mutable cache_statistics statistics;
+};
+
+}
@@ -0,0 +1,78 @@
+#include "reader_frame.hpp"
+
+#include "reader_binarization.hpp"
+#include "reader_util.hpp"
+
+namespace reader
+{
+
+////////////////////////////////////////
+//
+// Class: frame
+//
+////////////////////////////////////////
+
+frame::ptr frame::create(const cv::Mat& capture)
+{
+	return ptr(new frame(capture));
+}
+
+frame::frame(const cv::Mat& capture)
+	:
+	capture(capture),
+	cropped(image_recognition::crop_widescreen(capture))
+{
+}
+
+const cv::Mat& frame::get_capture() const
+{
+	return capture;
+}
+
+const cv::Mat& frame::get_cropped() const
+{
+	return cropped;
+}
+
+const cv::Mat& frame::get_gray() const
+{
+	std::call_once(gray_flag, [this]()
+		{
+			binarization::to_gray(cropped, gray);
+		});
+
+	return gray;
+}
+
+cv::Mat frame::get_gray(const cv::Mat& region) const
+{
+	if (region.empty() || region.channels() == 1)
+		return region;
+
+	if (region.datastart == cropped.datastart && region.data >= cropped.data)
+	{
+		// locate the view by its offset in the buffer of the crop
+		std::ptrdiff_t offset = region.data - cropped.data;
+		int y = static_cast<int>(offset / static_cast<std::ptrdiff_t>(cropped.step));
+		int x = static_cast<int>(offset % static_cast<std::ptrdiff_t>(cropped.step) / static_cast<std::ptrdiff_t>(cropped.elemSize()));
+
+		if (x + region.cols <= cropped.cols && y + region.rows <= cropped.rows)
+			return get_gray()(cv::Rect(x, y, region.cols, region.rows));
+	}
+
+	cv::Mat converted;
+	binarization::to_gray(region, converted);
+	return converted;
+}
+
+cv::Size frame::size() const
+{
+	return capture.size();
+}
+
+bool frame::empty() const
+{
+	return capture.empty();
+}
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+
+#include <opencv2/core/mat.hpp>
+
+namespace reader
+{
+
+/*
+* An immutable screenshot shared by all readers of a request.
+* Holds the capture, its widescreen crop as a view and derived planes
+* that are computed on first use. Readers keep views into the frame
+* instead of deep copies, so nobody must write into its pixels.
+*/
+class frame
+{
+public:
+	typedef std::shared_ptr<const frame> ptr;
+
+	/*
+	* Wraps @param{capture} without copying it. The caller must not modify
+	* the pixels of @param{capture} afterwards.
+	*/
+	static ptr create(const cv::Mat& capture);
+
+	const cv::Mat& get_capture() const;
+
+	/*
+	* The capture cropped to 16:9, a view into get_capture()
+	*/
+	const cv::Mat& get_cropped() const;
+
+	/*
+	* Single channel version of get_cropped(), converted on the first call
+	*/
+	const cv::Mat& get_gray() const;
+
+	/*
+	* Returns the gray plane of @param{region}. If @param{region} is a view into
+	* get_cropped() (e.g. a pane) the corresponding view into get_gray() is returned,
+	* otherwise @param{region} is converted.
+	*/
+	cv::Mat get_gray(const cv::Mat& region) const;
+
+	cv::Size size() const;
+	bool empty() const;
+
+	frame(const frame&) = delete;
+	frame& operator=(const frame&) = delete;
+
+private:
+	explicit frame(const cv::Mat& capture);
+
+	cv::Mat capture;
+	cv::Mat cropped;
+
+	mutable std::once_flag gray_flag;
+	mutable cv::Mat gray;
+};
+
+}
@@ -1,6 +1,7 @@
 #include "reader_hud_statistics.hpp"
 
 
+#include <filesystem>
 #include <iostream>
 #include <queue>
 #include <regex>
@@ -18,11 +19,18 @@ hud_statistics::hud_statistics(image_recognition& recog)
 
 void hud_statistics::update(const std::string& language,
 	const cv::Mat& img)
+{
+	update(language, frame::create(img));
+}
+
+void hud_statistics::update(const std::string& language,
+	const frame::ptr& img)
 {
 	population_icon_position = cv::Rect(-1, -1, 0, 0);
 	selected_island.clear();
-	recog.update(language);
-	img.copyTo(this->screenshot);
+	recog.update(language, img->size());
+	current_frame = img;
+	screenshot = img->get_capture();
 }
 
 cv::Rect hud_statistics::find_population_icon()
@@ -38,7 +46,21 @@ cv::Rect hud_statistics::find_population_icon()
 	};
 
 	static template_images templates;
-	std::string resolution_id = std::to_string(screenshot.cols) + "x" + std::to_string(screenshot.rows);
+
+	// search at the normalized resolution if there are templates for it
+	double scale = recog.get_geometry_scale();
+	cv::Size search_size(static_cast<int>(std::lround(screenshot.cols * scale)), static_cast<int>(std::lround(screenshot.rows * scale)));
+	auto get_template_path = [](const cv::Size& size)
+	{
+		return "image_recon/" + std::to_string(size.width) + "x" + std::to_string(size.height) + "/population_symbol_with_bar.bmp";
+	};
+	if (scale < 1. && !std::filesystem::exists(get_template_path(search_size)))
+	{
+		scale = 1.;
+		search_size = screenshot.size();
+	}
+
+	std::string resolution_id = std::to_string(search_size.width) + "x" + std::to_string(search_size.height);
 	if (templates.resolution_id != resolution_id)
 	{
 		try {
@@ -46,7 +68,7 @@ cv::Rect hud_statistics::find_population_icon()
 				std::cout << "detected resolution: " << resolution_id
 					<< std::endl;
 			}
-			templates.island_pop_symbol = recog.load_image("image_recon/" + resolution_id + "/population_symbol_with_bar.bmp");
+			templates.island_pop_symbol = recog.load_image(get_template_path(search_size));
 			templates.resolution_id = resolution_id;
 		}
 		catch (const std::invalid_argument& e) {
@@ -59,7 +81,7 @@ cv::Rect hud_statistics::find_population_icon()
 
 	cv::Mat im_copy = screenshot(cv::Rect(cv::Point(0, 0), cv::Size(screenshot.cols, screenshot.rows / 2)));
 
-	const auto pop_symbol_match_result = recog.match_template(im_copy, templates.island_pop_symbol);
+	const auto pop_symbol_match_result = recog.match_template(image_recognition::downscale(im_copy, scale), templates.island_pop_symbol);
 
 	if (!fit_criterion(pop_symbol_match_result.second)) {
 		if (recog.is_verbose()) {
@@ -69,6 +91,13 @@ cv::Rect hud_statistics::find_population_icon()
 	}
 	population_icon_position = pop_symbol_match_result.first;
 
+	if (scale < 1.)
+	{
+		const cv::Rect& match = pop_symbol_match_result.first;
+		auto round = [scale](int value) { return static_cast<int>(std::lround(value / scale)); };
+		population_icon_position = cv::Rect(round(match.x), round(match.y), round(match.width), round(match.height));
+	}
+
 	return population_icon_position;
 }
 
@@ -89,11 +118,31 @@ std::map<unsigned int, int> hud_statistics::get_anno_population_from_ocr_result(
 		return lhs.similarity < rhs.similarity;
 		});
 
+	const float threshold = 0.66f;
+
+	// matches with a similarity <= threshold are never used, only score keywords that can exceed it
+	if (indexed_population_levels != &dictionary)
+	{
+		population_index.clear();
+		population_keywords.clear();
+		for (const auto& kw : dictionary)
+		{
+			population_index.insert(kw.second);
+			population_keywords.push_back(&kw);
+		}
+		indexed_population_levels = &dictionary;
+	}
+
 	int i = 0;
 	for (const auto& pop_name_word : ocr_result)
 	{
-		for (const auto& kw : dictionary)
+		std::vector<std::size_t> candidates = population_index.find(pop_name_word.first, [&](std::size_t keyword_length) {
+			return static_cast<int>(threshold * std::max(pop_name_word.first.size(), keyword_length));
+		});
+
+		for (std::size_t id : candidates)
 		{
+			const auto& kw = *population_keywords[id];
 			queue.emplace(match{
 				recog.lcs_length(pop_name_word.first, kw.second) / (float)std::max(pop_name_word.first.size(), kw.second.size()),
 				&kw,
@@ -108,7 +157,6 @@ std::map<unsigned int, int> hud_statistics::get_anno_population_from_ocr_result(
 	std::set<const std::pair<std::string, cv::Rect>*> matched_occurences;
 
 	float similarity = 1.f;
-	const float threshold = 0.66f;
 	while (queue.size() && similarity > threshold)
 	{
 		const match m = queue.top(); queue.pop();
@@ -214,8 +262,7 @@ std::map<unsigned int, int> hud_statistics::get_population_amount()
 	if (pop_icon_position.tl().x <= 0)
 		return std::map<unsigned int, int>();
 
-	auto region = recog.find_rgb_region(screenshot, pop_icon_position.br(), 0);
-	cv::Rect aa_bb = recog.get_aa_bb(region);
+	cv::Rect aa_bb = recog.find_rgb_region_bounds(screenshot, pop_icon_position.br(), 0).first;
 	if (aa_bb.area() <= 0)
 		return std::map<unsigned int, int>();
 
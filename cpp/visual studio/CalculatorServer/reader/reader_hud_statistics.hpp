@@ -12,6 +12,11 @@ public:
 
 	void update(const std::string& language,
 		const cv::Mat& img);
+	/*
+	* Reads from @param{img} without copying it
+	*/
+	void update(const std::string& language,
+		const frame::ptr& img);
 
 	/*
 * Searches for population icon of of tooltip of HUD
@@ -36,10 +41,17 @@ public:
 
 private:
 	image_recognition& recog;
+	frame::ptr current_frame;
 	cv::Mat screenshot;
 	std::string selected_island;
 	// -1 if not searched for, 0 if not found
 	cv::Rect population_icon_position;
+
+	// index over the population_levels of the current language, rebuilt when the language changes
+	mutable const std::map<unsigned int, std::string>* indexed_population_levels = nullptr;
+	mutable ngram_index population_index;
+	// keyword ids equal the indices into population_keywords
+	mutable std::vector<const std::pair<const unsigned int, std::string>*> population_keywords;
 };
 
 }
\ No newline at end of file
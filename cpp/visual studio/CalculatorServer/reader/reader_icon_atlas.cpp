@@ -0,0 +1,265 @@
+#include "reader_icon_atlas.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define READER_ATLAS_SSE2
+#endif
+
+namespace reader
+{
+
+////////////////////////////////////////
+//
+// Class: icon_atlas
+//
+////////////////////////////////////////
+
+icon_atlas::icon_atlas(const cv::Size& size, int type)
+	:
+	template_size(size),
+	type(type),
+	stride(0),
+	count(0),
+	signature_length(GRID * GRID * CV_MAT_CN(type))
+{
+	std::size_t bytes = size.area() * CV_ELEM_SIZE(type);
+	stride = (bytes + 63) / 64 * 64;
+}
+
+std::size_t icon_atlas::find(const cv::Mat& icon) const
+{
+	auto iter = slots.find(icon.data);
+	if (iter == slots.end())
+		return npos;
+
+	return iter->second;
+}
+
+std::size_t icon_atlas::add(const cv::Mat& icon, const cv::Mat& template_img)
+{
+	if (template_img.size() != template_size || template_img.type() != type)
+		throw std::invalid_argument("template does not match atlas layout");
+
+	if (count == static_cast<std::size_t>(buffer.rows))
+	{
+		cv::Mat grown(std::max(16, 2 * buffer.rows), static_cast<int>(stride), CV_8UC1, cv::Scalar(0));
+		if (count)
+			buffer.copyTo(grown(cv::Rect(0, 0, buffer.cols, buffer.rows)));
+		buffer = grown;
+	}
+
+	cv::Mat slot_view = buffer.row(static_cast<int>(count));
+	pack(template_img).copyTo(slot_view);
+
+	std::vector<std::int32_t> signature = compute_signature(template_img);
+	signatures.insert(signatures.end(), signature.begin(), signature.end());
+
+	icons.push_back(icon);
+	slots.emplace(icon.data, count);
+	return count++;
+}
+
+cv::Mat icon_atlas::get_template(std::size_t slot) const
+{
+	return cv::Mat(template_size, type, const_cast<unsigned char*>(buffer.ptr<unsigned char>(static_cast<int>(slot))));
+}
+
+std::size_t icon_atlas::size() const
+{
+	return count;
+}
+
+const cv::Size& icon_atlas::get_template_size() const
+{
+	return template_size;
+}
+
+std::vector<std::size_t> icon_atlas::find_nearest(const cv::Mat& query,
+	const std::vector<std::size_t>& candidates,
+	float& best_score,
+	const std::vector<std::size_t>& priority) const
+{
+	std::vector<std::size_t> result;
+	if (query.size() != template_size || query.type() != type)
+		return result;
+
+	cv::Mat packed_query = pack(query);
+	const unsigned char* q = packed_query.ptr<unsigned char>();
+	std::vector<std::int32_t> query_signature = compute_signature(query);
+	std::vector<bool> evaluated(candidates.size(), false);
+
+	auto evaluate = [&](std::size_t i)
+	{
+		evaluated[i] = true;
+		float score = to_score(sum_of_absolute_differences(q, buffer.ptr<unsigned char>(static_cast<int>(candidates[i])), stride));
+
+		if (score == best_score)
+		{
+			result.push_back(i);
+		}
+		else if (score < best_score)
+		{
+			result.clear();
+			result.push_back(i);
+			best_score = score;
+		}
+	};
+
+	for (std::size_t i : priority)
+		if (i < candidates.size() && !evaluated[i])
+			evaluate(i);
+
+	// coarse stage: (lower bound, index into candidates)
+	std::vector<std::pair<std::uint64_t, std::size_t>> bounds;
+	bounds.reserve(candidates.size());
+	for (std::size_t i = 0; i < candidates.size(); i++)
+	{
+		if (evaluated[i])
+			continue;
+
+		bounds.emplace_back(signature_distance(query_signature.data(),
+			signatures.data() + candidates[i] * signature_length,
+			signature_length), i);
+	}
+	std::sort(bounds.begin(), bounds.end());
+
+	// fine stage
+	for (const auto& bound : bounds)
+	{
+		if (to_score(bound.first) > best_score)
+			break;
+
+		evaluate(bound.second);
+	}
+
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+std::vector<std::size_t> icon_atlas::find_nearest_exhaustive(const cv::Mat& query,
+	const std::vector<std::size_t>& candidates,
+	float& best_score) const
+{
+	std::vector<std::size_t> result;
+	if (query.size() != template_size || query.type() != type)
+		return result;
+
+	cv::Mat packed_query = pack(query);
+	const unsigned char* q = packed_query.ptr<unsigned char>();
+
+	for (std::size_t i = 0; i < candidates.size(); i++)
+	{
+		float score = to_score(sum_of_absolute_differences(q, buffer.ptr<unsigned char>(static_cast<int>(candidates[i])), stride));
+
+		if (score == best_score)
+		{
+			result.push_back(i);
+		}
+		else if (score < best_score)
+		{
+			result.clear();
+			result.push_back(i);
+			best_score = score;
+		}
+	}
+
+	return result;
+}
+
+std::vector<std::int32_t> icon_atlas::compute_signature(const cv::Mat& img) const
+{
+	const int channels = img.channels();
+	std::vector<std::int32_t> signature(signature_length, 0);
+
+	std::vector<int> cell_offsets(img.cols);
+	for (int x = 0; x < img.cols; x++)
+		cell_offsets[x] = x * GRID / img.cols * channels;
+
+	for (int y = 0; y < img.rows; y++)
+	{
+		const unsigned char* row = img.ptr<unsigned char>(y);
+		std::int32_t* cell_row = signature.data() + y * GRID / img.rows * GRID * channels;
+
+		for (int x = 0; x < img.cols; x++)
+		{
+			std::int32_t* cell = cell_row + cell_offsets[x];
+			for (int c = 0; c < channels; c++)
+				cell[c] += row[x * channels + c];
+		}
+	}
+
+	return signature;
+}
+
+std::uint64_t icon_atlas::signature_distance(const std::int32_t* a, const std::int32_t* b, std::size_t length)
+{
+	// |sum(a) - sum(b)| <= sum(|a - b|) for every cell and channel
+	std::uint64_t distance = 0;
+	for (std::size_t i = 0; i < length; i++)
+		distance += std::abs(a[i] - b[i]);
+	return distance;
+}
+
+cv::Mat icon_atlas::pack(const cv::Mat& img) const
+{
+	cv::Mat packed(1, static_cast<int>(stride), CV_8UC1, cv::Scalar(0));
+	const std::size_t row_bytes = template_size.width * CV_ELEM_SIZE(type);
+
+	for (int y = 0; y < img.rows; y++)
+		std::memcpy(packed.data + y * row_bytes, img.ptr<unsigned char>(y), row_bytes);
+
+	return packed;
+}
+
+float icon_atlas::to_score(std::uint64_t sad) const
+{
+	// same arithmetic as cv::sum(diff).ddot(cv::Scalar::ones()) / rows / cols
+	return static_cast<float>(static_cast<double>(sad) / template_size.height / template_size.width);
+}
+
+std::uint64_t icon_atlas::sum_of_absolute_differences(const unsigned char* a, const unsigned char* b, std::size_t length)
+{
+#if defined(__AVX2__)
+	__m256i acc = _mm256_setzero_si256();
+	for (std::size_t i = 0; i < length; i += 64)
+	{
+		__m256i sad0 = _mm256_sad_epu8(
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+		__m256i sad1 = _mm256_sad_epu8(
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + 32)),
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i + 32)));
+		acc = _mm256_add_epi64(acc, _mm256_add_epi64(sad0, sad1));
+	}
+
+	alignas(32) std::uint64_t lanes[4];
+	_mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(READER_ATLAS_SSE2)
+	__m128i acc = _mm_setzero_si128();
+	for (std::size_t i = 0; i < length; i += 16)
+	{
+		acc = _mm_add_epi64(acc, _mm_sad_epu8(
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i))));
+	}
+
+	alignas(16) std::uint64_t lanes[2];
+	_mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+	return lanes[0] + lanes[1];
+#else
+	std::uint64_t sum = 0;
+	for (std::size_t i = 0; i < length; i++)
+		sum += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+	return sum;
+#endif
+}
+
+}
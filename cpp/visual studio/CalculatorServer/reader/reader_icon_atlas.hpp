@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+namespace reader
+{
+
+/*
+* Stores equally sized BGRA icon templates in one contiguous, aligned buffer.
+* Each template occupies a slot of @ref{stride} bytes, padded with zeros.
+*/
+class icon_atlas
+{
+public:
+	static const std::size_t npos = static_cast<std::size_t>(-1);
+
+	icon_atlas(const cv::Size& size, int type);
+
+	/*
+	* Returns the slot of the template created from @param{icon} or npos
+	*/
+	std::size_t find(const cv::Mat& icon) const;
+
+	/*
+	* Stores @param{template_img} (which must have the size and type of the atlas)
+	* as template of @param{icon} and returns its slot
+	*/
+	std::size_t add(const cv::Mat& icon, const cv::Mat& template_img);
+
+	/*
+	* Returns a header for the template in @param{slot}, no data is copied.
+	* The header dangles after the next add, clone it to keep the template.
+	*/
+	cv::Mat get_template(std::size_t slot) const;
+
+	std::size_t size() const;
+	const cv::Size& get_template_size() const;
+
+	/*
+	* Scores @param{query} against the templates in @param{slots} by the mean
+	* absolute difference per pixel (summed over all channels).
+	* Returns the indices into @param{slots} of all templates with the lowest score
+	* in ascending order.
+	* Only templates with a score <= @param{best_score} are considered, the lowest
+	* score is written back to @param{best_score}.
+	*
+	* Candidates are first ranked by the distance of their block sum signatures,
+	* which is a lower bound of the full score. Full resolution comparisons stop
+	* as soon as this bound exceeds the best score found, so the result equals
+	* an exhaustive search.
+	* @param{priority} lists indices into @param{slots} that are compared first,
+	* e.g. likely matches. A tight early score lets the cascade stop sooner.
+	*/
+	std::vector<std::size_t> find_nearest(const cv::Mat& query,
+		const std::vector<std::size_t>& slots,
+		float& best_score,
+		const std::vector<std::size_t>& priority = std::vector<std::size_t>()) const;
+
+	/*
+	* Same as find_nearest but compares @param{query} with every template,
+	* reference for checking the cascade
+	*/
+	std::vector<std::size_t> find_nearest_exhaustive(const cv::Mat& query,
+		const std::vector<std::size_t>& slots,
+		float& best_score) const;
+
+	/*
+	* Copies @param{img} into a zero padded, aligned buffer of the layout used by the atlas
+	*/
+	cv::Mat pack(const cv::Mat& img) const;
+
+	/*
+	* Sum of absolute differences of two buffers of @param{length} bytes.
+	* @param{length} must be a multiple of 64.
+	*/
+	static std::uint64_t sum_of_absolute_differences(const unsigned char* a, const unsigned char* b, std::size_t length);
+
+	/*
+	* Sums of each channel over the cells of a GRID x GRID partition of @param{img}
+	*/
+	std::vector<std::int32_t> compute_signature(const cv::Mat& img) const;
+
+	/*
+	* Lower bound for the sum of absolute differences of two images
+	* computed from their signatures
+	*/
+	static std::uint64_t signature_distance(const std::int32_t* a, const std::int32_t* b, std::size_t length);
+
+	static const int GRID = 8;
+
+private:
+	cv::Size template_size;
+	int type;
+	std::size_t stride;
+	std::size_t count;
+	std::size_t signature_length;
+	std::vector<std::int32_t> signatures;
+
+	// one row per slot, allocated by OpenCV and therefore aligned
+	cv::Mat buffer;
+	// keeps the source buffers alive so their addresses are not reused
+	std::vector<cv::Mat> icons;
+	std::map<const unsigned char*, std::size_t> slots;
+
+	float to_score(std::uint64_t sad) const;
+};
+
+}
@@ -0,0 +1,134 @@
+#include "reader_icon_hash.hpp"
+
+#include <algorithm>
+
+#include <opencv2/imgproc.hpp>
+
+namespace reader
+{
+
+////////////////////////////////////////
+//
+// Class: icon_hash_index
+//
+////////////////////////////////////////
+
+std::uint64_t icon_hash_index::compute_hash(const cv::Mat& img)
+{
+	if (img.empty())
+		return 0;
+
+	cv::Mat gray, thumbnail;
+	if (img.channels() == 4)
+		cv::cvtColor(img, gray, cv::COLOR_BGRA2GRAY);
+	else
+		gray = img;
+
+	cv::resize(gray, thumbnail, cv::Size(9, 8), 0, 0, cv::INTER_AREA);
+
+	std::uint64_t hash = 0;
+	for (int y = 0; y < 8; y++)
+	{
+		const unsigned char* row = thumbnail.ptr<unsigned char>(y);
+		for (int x = 0; x < 8; x++)
+			hash = hash << 1 | (row[x] < row[x + 1] ? 1 : 0);
+	}
+
+	return hash;
+}
+
+unsigned int icon_hash_index::hamming_distance(std::uint64_t a, std::uint64_t b)
+{
+	return popcount(a ^ b);
+}
+
+unsigned int icon_hash_index::popcount(std::uint64_t x)
+{
+	x = x - ((x >> 1) & 0x5555555555555555ull);
+	x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+	x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+	return static_cast<unsigned int>((x * 0x0101010101010101ull) >> 56);
+}
+
+void icon_hash_index::insert(std::uint64_t hash, unsigned int guid)
+{
+	count++;
+
+	if (nodes.empty())
+	{
+		nodes.push_back(node{ hash, { guid }, {} });
+		return;
+	}
+
+	std::size_t current = 0;
+	while (true)
+	{
+		unsigned int distance = hamming_distance(hash, nodes[current].hash);
+		if (!distance)
+		{
+			nodes[current].guids.push_back(guid);
+			return;
+		}
+
+		auto iter = nodes[current].children.find(distance);
+		if (iter == nodes[current].children.end())
+		{
+			nodes[current].children.emplace(distance, nodes.size());
+			nodes.push_back(node{ hash, { guid }, {} });
+			return;
+		}
+
+		current = iter->second;
+	}
+}
+
+std::vector<unsigned int> icon_hash_index::find(std::uint64_t hash, unsigned int max_distance) const
+{
+	std::vector<std::pair<unsigned int, unsigned int>> matches; // (distance, guid)
+
+	if (!nodes.empty())
+	{
+		std::vector<std::size_t> open({ 0 });
+		while (!open.empty())
+		{
+			const node& current = nodes[open.back()];
+			open.pop_back();
+
+			unsigned int distance = hamming_distance(hash, current.hash);
+			if (distance <= max_distance)
+				for (unsigned int guid : current.guids)
+					matches.emplace_back(distance, guid);
+
+			// triangle inequality: only subtrees within [distance - max, distance + max] can match
+			unsigned int lower = distance > max_distance ? distance - max_distance : 0;
+			for (auto iter = current.children.lower_bound(lower);
+				iter != current.children.end() && iter->first <= distance + max_distance;
+				++iter)
+			{
+				open.push_back(iter->second);
+			}
+		}
+	}
+
+	std::sort(matches.begin(), matches.end());
+
+	std::vector<unsigned int> result;
+	result.reserve(matches.size());
+	for (const auto& match : matches)
+		result.push_back(match.second);
+
+	return result;
+}
+
+std::size_t icon_hash_index::size() const
+{
+	return count;
+}
+
+void icon_hash_index::clear()
+{
+	nodes.clear();
+	count = 0;
+}
+
+}
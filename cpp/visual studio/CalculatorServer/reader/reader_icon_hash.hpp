@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+namespace reader
+{
+
+/*
+* BK-tree over 64 bit perceptual icon hashes
+* answers nearest neighbour queries by Hamming distance
+*/
+class icon_hash_index
+{
+public:
+	/*
+	* Computes a difference hash (dHash) of a BGRA or gray image:
+	* one bit per horizontally adjacent pixel pair of a 9x8 thumbnail
+	*/
+	static std::uint64_t compute_hash(const cv::Mat& img);
+
+	static unsigned int hamming_distance(std::uint64_t a, std::uint64_t b);
+	static unsigned int popcount(std::uint64_t x);
+
+	void insert(std::uint64_t hash, unsigned int guid);
+
+	/*
+	* Returns the GUIDs of all hashes with a distance <= @param{max_distance}
+	* ordered by increasing distance
+	*/
+	std::vector<unsigned int> find(std::uint64_t hash, unsigned int max_distance) const;
+
+	std::size_t size() const;
+	void clear();
+
+private:
+	struct node
+	{
+		std::uint64_t hash;
+		std::vector<unsigned int> guids;
+		// distance to this node -> child index
+		std::map<unsigned int, std::size_t> children;
+	};
+
+	std::vector<node> nodes;
+	std::size_t count = 0;
+};
+
+}
@@ -0,0 +1,106 @@
+#include "reader_line_detection.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define READER_LINE_DETECTION_SSE2
+#endif
+
+namespace reader
+{
+
+////////////////////////////////////////
+//
+// Class: horizontal_line_detector
+//
+////////////////////////////////////////
+
+std::vector<int> horizontal_line_detector::find_lines(const cv::Mat& gray, float line_density)
+{
+	std::vector<int> lines;
+	if (gray.rows < 2 || gray.channels() != 1)
+		return lines;
+
+	// same acceptance as the filter applied to the Hough lines
+	const int min_length = static_cast<int>(std::max(line_density, 0.8f) * gray.cols);
+	const int max_gap = static_cast<int>(0.1f * gray.cols);
+
+	std::vector<unsigned char> edges(gray.cols);
+	bool previous_line = false;
+
+	for (int y = 1; y < gray.rows; y++)
+	{
+		int count = mark_edges(gray.ptr<unsigned char>(y - 1), gray.ptr<unsigned char>(y), edges.data(), gray.cols, EDGE_THRESHOLD);
+
+		// most rows are rejected by their count
+		bool line = count >= min_length && longest_run(edges.data(), gray.cols, max_gap) >= min_length;
+		if (line && !previous_line)
+			lines.push_back(y);
+		previous_line = line;
+	}
+
+	return lines;
+}
+
+int horizontal_line_detector::mark_edges(const unsigned char* above, const unsigned char* row, unsigned char* edges, int width, unsigned char threshold)
+{
+	int count = 0;
+	int x = 0;
+
+#ifdef READER_LINE_DETECTION_SSE2
+	if (threshold > 0)
+	{
+		const __m128i limit = _mm_set1_epi8(static_cast<char>(threshold - 1));
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i one = _mm_set1_epi8(1);
+		__m128i sum = _mm_setzero_si128();
+
+		for (; x + 16 <= width; x += 16)
+		{
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(above + x));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+			__m128i difference = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+
+			// difference >= threshold <=> difference - (threshold - 1) > 0
+			__m128i mask = _mm_xor_si128(_mm_cmpeq_epi8(_mm_subs_epu8(difference, limit), zero), _mm_set1_epi8(static_cast<char>(0xff)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(edges + x), mask);
+			sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_and_si128(mask, one), zero));
+		}
+
+		count = _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+	}
+#endif
+
+	for (; x < width; x++)
+	{
+		int difference = std::abs(static_cast<int>(row[x]) - above[x]);
+		edges[x] = difference >= threshold ? 0xff : 0;
+		count += edges[x] & 1;
+	}
+
+	return count;
+}
+
+int horizontal_line_detector::longest_run(const unsigned char* edges, int width, int max_gap)
+{
+	int longest = 0;
+	int begin = -1; // first edge pixel of the current run
+	int last = -1; // last edge pixel of the current run
+
+	for (int x = 0; x < width; x++)
+	{
+		if (!edges[x])
+			continue;
+
+		if (begin < 0 || x - last - 1 > max_gap)
+			begin = x;
+		last = x;
+		longest = std::max(longest, last - begin + 1);
+	}
+
+	return longest;
+}
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+namespace reader
+{
+
+/*
+* Finds the separator lines of tables from the projection of horizontal edges
+* onto the rows of a gray image, replaces Canny + HoughLinesP for axis aligned lines
+*/
+class horizontal_line_detector
+{
+public:
+	/*
+	* Returns the rows of @param{gray} that contain a horizontal edge spanning at least
+	* max(@param{line_density}, 0.8) of the width with gaps of at most 10 % of the width.
+	* Of several adjacent edge rows only the first one is reported.
+	*/
+	static std::vector<int> find_lines(const cv::Mat& gray, float line_density);
+
+	/*
+	* Sets @param{edges}[x] to 0xff if |@param{row}[x] - @param{above}[x]| >= @param{threshold},
+	* to 0 otherwise, and returns the number of edge pixels
+	*/
+	static int mark_edges(const unsigned char* above, const unsigned char* row, unsigned char* edges, int width, unsigned char threshold);
+
+	/*
+	* Length of the longest run of edge pixels that does not contain gaps longer than @param{max_gap}
+	*/
+	static int longest_run(const unsigned char* edges, int width, int max_gap);
+
+	// corresponds to the Canny threshold of image_recognition::detect_edges for a step edge
+	static const unsigned char EDGE_THRESHOLD = 13;
+};
+
+}
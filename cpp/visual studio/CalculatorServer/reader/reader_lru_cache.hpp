@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <utility>
+
+namespace reader
+{
+
+struct cache_statistics
+{
+	std::size_t hits = 0;
+	std::size_t misses = 0;
+	std::size_t size = 0;
+	std::size_t capacity = 0;
+};
+
+/*
+* Bounded map that evicts the least recently used entry once it holds
+* @ref{capacity} entries.
+*/
+template <typename Key, typename Value>
+class lru_cache
+{
+public:
+	lru_cache(std::size_t capacity)
+		:
+		capacity(capacity)
+	{
+	}
+
+	/*
+	* Returns a pointer to the cached value or nullptr and counts the hit or miss.
+	* The pointer is valid until the next call to insert or clear.
+	*/
+	const Value* find(const Key& key)
+	{
+		auto iter = index.find(key);
+		if (iter == index.end())
+		{
+			statistics.misses++;
+			return nullptr;
+		}
+
+		statistics.hits++;
+		entries.splice(entries.begin(), entries, iter->second);
+		return &iter->second->second;
+	}
+
+	void insert(const Key& key, const Value& value)
+	{
+		auto iter = index.find(key);
+		if (iter != index.end())
+		{
+			iter->second->second = value;
+			entries.splice(entries.begin(), entries, iter->second);
+			return;
+		}
+
+		if (entries.size() >= capacity && !entries.empty())
+		{
+			index.erase(entries.back().first);
+			entries.pop_back();
+		}
+
+		entries.emplace_front(key, value);
+		index.emplace(key, entries.begin());
+	}
+
+	void clear()
+	{
+		entries.clear();
+		index.clear();
+	}
+
+	cache_statistics get_statistics() const
+	{
+		cache_statistics result = statistics;
+		result.size = entries.size();
+		result.capacity = capacity;
+		return result;
+	}
+
+private:
+	std::size_t capacity;
+	cache_statistics statistics;
+
+	// most recently used first
+	std::list<std::pair<Key, Value>> entries;
+	std::map<Key, typename std::list<std::pair<Key, Value>>::iterator> index;
+};
+
+}
@@ -0,0 +1,146 @@
+#include "reader_row_grid.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "reader_line_detection.hpp"
+
+namespace reader
+{
+
+////////////////////////////////////////
+//
+// Class: row_grid_tracker
+//
+////////////////////////////////////////
+
+std::vector<int> row_grid_tracker::get_lines(const cv::Mat& pane,
+	float line_density,
+	const std::function<std::vector<int>(const cv::Mat&)>& detect)
+{
+	cv::Size whole_size;
+	cv::Point offset;
+	pane.locateROI(whole_size, offset);
+	pane_key key(offset.x, offset.y, pane.cols, pane.rows, static_cast<int>(100 * line_density));
+
+	{
+		std::lock_guard<std::mutex> lock(grids_mutex);
+		auto iter = grids.find(key);
+		if (iter != grids.end() && verify(pane, iter->second))
+		{
+			statistics.hits++;
+			return iter->second;
+		}
+		statistics.misses++;
+	}
+
+	std::vector<int> lines = detect(pane);
+
+	std::lock_guard<std::mutex> lock(grids_mutex);
+	if (lines.empty())
+	{
+		grids.erase(key);
+		return lines;
+	}
+
+	if (grids.size() >= MAX_GRIDS && grids.find(key) == grids.end())
+		grids.clear();
+	grids[key] = lines;
+
+	return lines;
+}
+
+bool row_grid_tracker::verify(const cv::Mat& pane, const std::vector<int>& lines)
+{
+	if (lines.empty() || pane.channels() != 4)
+		return false;
+
+	int previous = -1;
+	for (int line : lines)
+	{
+		if (line < 1 || line >= pane.rows)
+			return false;
+
+		// Hough lines lie on either side of the step
+		int edges = 0;
+		for (int y = line - LINE_TOLERANCE; y <= line + LINE_TOLERANCE; y++)
+			edges = std::max(edges, count_edges(pane, y));
+		if (edges < PROBES * 3 / 4)
+			return false;
+
+		// a row scrolled into the place between two lines would show a line there
+		int middle = (previous + line) / 2;
+		if (previous >= 0 && line - previous > 2 && count_edges(pane, middle) >= PROBES / 2)
+			return false;
+
+		previous = line;
+	}
+
+	// a row scrolled in above the first or below the last line would add a line up to one pitch away
+	int pitch = get_pitch(lines);
+	for (int y = lines.front() - LINE_TOLERANCE - pitch; y < lines.front() - LINE_TOLERANCE; y++)
+		if (count_edges(pane, y) >= PROBES / 2)
+			return false;
+	for (int y = lines.back() + LINE_TOLERANCE + 1; y <= lines.back() + LINE_TOLERANCE + pitch; y++)
+		if (count_edges(pane, y) >= PROBES / 2)
+			return false;
+
+	return true;
+}
+
+cache_statistics row_grid_tracker::get_statistics() const
+{
+	std::lock_guard<std::mutex> lock(grids_mutex);
+	cache_statistics result = statistics;
+	result.size = grids.size();
+	result.capacity = MAX_GRIDS;
+	return result;
+}
+
+void row_grid_tracker::clear()
+{
+	std::lock_guard<std::mutex> lock(grids_mutex);
+	grids.clear();
+}
+
+bool row_grid_tracker::is_edge(const cv::Mat& pane, int y, int x)
+{
+	// gray values with the coefficients of cv::cvtColor
+	auto gray = [&](int row)
+	{
+		const cv::Vec4b& pixel = pane.at<cv::Vec4b>(row, x);
+		return (pixel[0] * 1868 + pixel[1] * 9617 + pixel[2] * 4899 + (1 << 13)) >> 14;
+	};
+
+	return std::abs(gray(y) - gray(y - 1)) >= horizontal_line_detector::EDGE_THRESHOLD;
+}
+
+int row_grid_tracker::get_pitch(const std::vector<int>& lines)
+{
+	// same minimum row height as image_recognition::get_rows
+	std::vector<int> heights;
+	for (std::size_t i = 1; i < lines.size(); i++)
+		if (lines[i] - lines[i - 1] > 10)
+			heights.push_back(lines[i] - lines[i - 1]);
+
+	if (heights.empty())
+		return 0;
+
+	std::nth_element(heights.begin(), heights.begin() + heights.size() / 2, heights.end());
+	return heights[heights.size() / 2];
+}
+
+int row_grid_tracker::count_edges(const cv::Mat& pane, int y)
+{
+	if (y < 1 || y >= pane.rows)
+		return 0;
+
+	int count = 0;
+	for (int i = 0; i < PROBES; i++)
+		if (is_edge(pane, y, (2 * i + 1) * pane.cols / (2 * PROBES)))
+			count++;
+
+	return count;
+}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+#include "reader_lru_cache.hpp"
+
+namespace reader
+{
+
+/*
+* Remembers the separator lines found in a table pane and verifies them on
+* later frames with a few pixel probes. Line detection only runs again when
+* the probes fail, e.g. after scrolling, a tab switch or a resolution change.
+*/
+class row_grid_tracker
+{
+public:
+	/*
+	* Returns the separator lines of @param{pane}, a BGRA view into a screenshot.
+	* Panes are identified by their location in the screenshot and @param{line_density}.
+	* Calls @param{detect} if the remembered lines do not pass the probes.
+	*/
+	std::vector<int> get_lines(const cv::Mat& pane,
+		float line_density,
+		const std::function<std::vector<int>(const cv::Mat&)>& detect);
+
+	/*
+	* Checks with PROBES pixel pairs per line that every line in @param{lines}
+	* is still a horizontal edge (up to LINE_TOLERANCE rows off) and that neither
+	* the rows halfway between them nor the rows up to one row pitch before the
+	* first and after the last line are
+	*/
+	static bool verify(const cv::Mat& pane, const std::vector<int>& lines);
+
+	cache_statistics get_statistics() const;
+	void clear();
+
+	static const int PROBES = 16;
+	static const int LINE_TOLERANCE = 1;
+	static const std::size_t MAX_GRIDS = 32;
+
+private:
+	// (x, y, width, height) of the pane in the screenshot, line density in percent
+	typedef std::tuple<int, int, int, int, int> pane_key;
+
+	mutable std::mutex grids_mutex;
+	std::map<pane_key, std::vector<int>> grids;
+	cache_statistics statistics;
+
+	static bool is_edge(const cv::Mat& pane, int y, int x);
+	static int count_edges(const cv::Mat& pane, int y);
+	// median distance of the lines that are more than 10 rows apart, 0 if there are none
+	static int get_pitch(const std::vector<int>& lines);
+};
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+#include <opencv2/core/mat.hpp>
+
+#include "reader_change_detection.hpp"
+#include "reader_lru_cache.hpp"
+
+namespace reader
+{
+
+/*
+* Remembers the parsed content of table rows by a hash of their pixels.
+* Rows are self-contained records, so a row that scrolled or persists across
+* frames is recognized again without OCR. Safe to use from map_rows callbacks.
+*/
+template <typename T>
+class row_memo
+{
+public:
+	row_memo(std::size_t capacity = CAPACITY)
+		:
+		rows(capacity)
+	{
+	}
+
+	/*
+	* Hash of the pixels and the size of @param{row}, independent of its position
+	*/
+	static std::uint64_t hash(const cv::Mat& row)
+	{
+		if (row.empty())
+			return 0;
+
+		std::uint64_t hash = tile_change_detector::hash_rows(row.ptr<unsigned char>(0), row.step, row.cols * row.elemSize(), row.rows);
+		return hash ^ (static_cast<std::uint64_t>(row.cols) << 32 | static_cast<std::uint64_t>(row.rows) << 16 | row.elemSize());
+	}
+
+	/*
+	* Copies the result stored for @param{key} to @param{value} and returns true if there is one
+	*/
+	bool find(std::uint64_t key, T& value)
+	{
+		std::lock_guard<std::mutex> lock(rows_mutex);
+		const T* result = rows.find(key);
+		if (!result)
+			return false;
+
+		value = *result;
+		return true;
+	}
+
+	void insert(std::uint64_t key, const T& value)
+	{
+		std::lock_guard<std::mutex> lock(rows_mutex);
+		rows.insert(key, value);
+	}
+
+	cache_statistics get_statistics() const
+	{
+		std::lock_guard<std::mutex> lock(rows_mutex);
+		return rows.get_statistics();
+	}
+
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(rows_mutex);
+		rows.clear();
+	}
+
+	static const std::size_t CAPACITY = 256;
+
+private:
+	mutable std::mutex rows_mutex;
+	lru_cache<std::uint64_t, T> rows;
+};
+
+}
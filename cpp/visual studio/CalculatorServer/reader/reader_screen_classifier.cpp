@@ -0,0 +1,88 @@
+#include "reader_screen_classifier.hpp"
+
+#include <algorithm>
+
+#include "reader_icon_hash.hpp"
+
+namespace reader
+{
+
+////////////////////////////////////////
+//
+// Class: screen_classifier
+//
+////////////////////////////////////////
+
+screen_classifier::verdict screen_classifier::classify(const std::string& language, unsigned int title, const cv::Mat& pane)
+{
+	if (pane.empty())
+		return verdict::ABSENT;
+
+	std::uint64_t hash = icon_hash_index::compute_hash(pane);
+
+	std::lock_guard<std::mutex> lock(titles_mutex);
+	auto iter = titles.find(title_key(language, title, pane.cols, pane.rows));
+	if (iter == titles.end())
+	{
+		statistics.misses++;
+		return verdict::UNKNOWN;
+	}
+
+	unsigned int distance = 64;
+	for (std::uint64_t fingerprint : iter->second.fingerprints)
+		distance = std::min(distance, icon_hash_index::hamming_distance(hash, fingerprint));
+
+	if (distance <= MATCH_DISTANCE)
+	{
+		statistics.hits++;
+		return verdict::PRESENT;
+	}
+
+	if (distance >= MISMATCH_DISTANCE && ++iter->second.absent_count < RECHECK_INTERVAL)
+	{
+		statistics.hits++;
+		return verdict::ABSENT;
+	}
+
+	// in between, or the periodic OCR of a pane far from all fingerprints
+	iter->second.absent_count = 0;
+	statistics.misses++;
+	return verdict::UNKNOWN;
+}
+
+void screen_classifier::learn(const std::string& language, unsigned int title, const cv::Mat& pane)
+{
+	if (pane.empty())
+		return;
+
+	std::uint64_t hash = icon_hash_index::compute_hash(pane);
+
+	std::lock_guard<std::mutex> lock(titles_mutex);
+	std::vector<std::uint64_t>& fingerprints = titles[title_key(language, title, pane.cols, pane.rows)].fingerprints;
+
+	for (std::uint64_t fingerprint : fingerprints)
+		if (icon_hash_index::hamming_distance(hash, fingerprint) <= MATCH_DISTANCE)
+			return;
+
+	// keep the most recent variants, e.g. with and without hover effects
+	if (fingerprints.size() >= MAX_FINGERPRINTS)
+		fingerprints.erase(fingerprints.begin());
+	fingerprints.push_back(hash);
+}
+
+cache_statistics screen_classifier::get_statistics() const
+{
+	std::lock_guard<std::mutex> lock(titles_mutex);
+	cache_statistics result = statistics;
+	for (const auto& entry : titles)
+		result.size += entry.second.fingerprints.size();
+	return result;
+}
+
+void screen_classifier::clear()
+{
+	std::lock_guard<std::mutex> lock(titles_mutex);
+	titles.clear();
+}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+#include "reader_lru_cache.hpp"
+
+namespace reader
+{
+
+/*
+* Decides from a fingerprint of a fixed title pane whether a menu is open.
+* The fingerprints of titles confirmed by OCR are remembered per language
+* and resolution. Panes close to one of them show the title, panes far from
+* all of them do not, only panes in between require OCR. Every RECHECK_INTERVAL-th
+* pane far from all of them requires OCR as well, so that a title rendered
+* differently than the remembered ones is still recognized.
+*/
+class screen_classifier
+{
+public:
+	enum class verdict
+	{
+		PRESENT,
+		ABSENT,
+		UNKNOWN
+	};
+
+	/*
+	* Classifies @param{pane} (BGRA) against the titles @param{title} learned for @param{language}
+	*/
+	verdict classify(const std::string& language, unsigned int title, const cv::Mat& pane);
+
+	/*
+	* Remembers @param{pane} as showing @param{title} in @param{language}
+	*/
+	void learn(const std::string& language, unsigned int title, const cv::Mat& pane);
+
+	cache_statistics get_statistics() const;
+	void clear();
+
+	// Hamming distances between 64 bit difference hashes
+	static const unsigned int MATCH_DISTANCE = 6;
+	static const unsigned int MISMATCH_DISTANCE = 20;
+	static const std::size_t MAX_FINGERPRINTS = 4;
+	static const unsigned int RECHECK_INTERVAL = 10;
+
+private:
+	// language, title, pane width, pane height
+	typedef std::tuple<std::string, unsigned int, int, int> title_key;
+
+	struct title_fingerprints
+	{
+		std::vector<std::uint64_t> fingerprints;
+		// panes far from all fingerprints since the last one passed to OCR
+		unsigned int absent_count = 0;
+	};
+
+	mutable std::mutex titles_mutex;
+	std::map<title_key, title_fingerprints> titles;
+	cache_statistics statistics;
+};
+
+}
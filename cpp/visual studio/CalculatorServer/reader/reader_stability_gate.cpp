@@ -0,0 +1,93 @@
+#include "reader_stability_gate.hpp"
+
+#include <algorithm>
+
+#include <opencv2/imgproc.hpp>
+
+#include "reader_binarization.hpp"
+#include "reader_util.hpp"
+
+namespace reader
+{
+
+////////////////////////////////////////
+//
+// Class: stability_gate
+//
+////////////////////////////////////////
+
+stability_gate::stability_gate(const std::vector<cv::Rect2f>& panes,
+	unsigned int required_frames,
+	std::chrono::milliseconds required_duration)
+	:
+	panes(panes),
+	required_frames(required_frames),
+	required_duration(required_duration),
+	stable_frames(0),
+	last_motion(std::chrono::steady_clock::now())
+{
+}
+
+bool stability_gate::update(const cv::Mat& img)
+{
+	auto now = std::chrono::steady_clock::now();
+
+	std::vector<cv::Mat> samples;
+	for (const cv::Rect2f& pane : panes)
+		samples.push_back(sample(image_recognition::get_pane(pane, img)));
+
+	bool moved = previous.size() != samples.size();
+	for (std::size_t i = 0; !moved && i < samples.size(); i++)
+		moved = has_moved(previous[i], samples[i]);
+
+	previous = std::move(samples);
+
+	if (moved)
+	{
+		stable_frames = 0;
+		last_motion = now;
+		return false;
+	}
+
+	stable_frames++;
+	return stable_frames >= required_frames && now - last_motion >= required_duration;
+}
+
+void stability_gate::reset()
+{
+	previous.clear();
+	stable_frames = 0;
+}
+
+cv::Mat stability_gate::sample(const cv::Mat& pane)
+{
+	if (pane.empty())
+		return cv::Mat();
+
+	// area interpolation averages out noise and compression artifacts
+	int height = std::max(1, pane.rows * THUMBNAIL_WIDTH / std::max(1, pane.cols));
+	cv::Mat thumbnail, gray;
+	cv::resize(pane, thumbnail, cv::Size(THUMBNAIL_WIDTH, height), 0, 0, cv::INTER_AREA);
+	binarization::to_gray(thumbnail, gray);
+	return gray;
+}
+
+bool stability_gate::has_moved(const cv::Mat& previous, const cv::Mat& current)
+{
+	if (previous.size() != current.size())
+		return true;
+
+	int moving = 0;
+	for (int y = 0; y < current.rows; y++)
+	{
+		const unsigned char* a = previous.ptr<unsigned char>(y);
+		const unsigned char* b = current.ptr<unsigned char>(y);
+		for (int x = 0; x < current.cols; x++)
+			if (std::abs(static_cast<int>(a[x]) - b[x]) > MOTION_THRESHOLD)
+				moving++;
+	}
+
+	return 100 * moving > MOTION_PERCENT * current.rows * current.cols;
+}
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+#include <opencv2/core/types.hpp>
+
+namespace reader
+{
+
+/*
+* Detects UI animations (tab switches, menus opening, items rendering in)
+* by comparing gray thumbnails of a few panes of successive captures.
+* Recognition should only run on frames for which update() returns true.
+*/
+class stability_gate
+{
+public:
+	/*
+	* @param{panes} regions relative to [0,1]^2 of the cropped screenshot to watch
+	* @param{required_frames} number of successive unchanged samples
+	* @param{required_duration} time since the last change
+	*/
+	stability_gate(const std::vector<cv::Rect2f>& panes,
+		unsigned int required_frames = 1,
+		std::chrono::milliseconds required_duration = std::chrono::milliseconds(100));
+
+	/*
+	* Samples the panes of @param{img} and compares them with the previous sample.
+	* Returns true if none of them changed in the last required_frames samples
+	* and during required_duration.
+	*/
+	bool update(const cv::Mat& img);
+
+	/*
+	* Forgets the previous sample, the next one counts as changed
+	*/
+	void reset();
+
+	static const int THUMBNAIL_WIDTH = 96;
+	// gray value difference of a thumbnail pixel that counts as motion
+	static const int MOTION_THRESHOLD = 12;
+	// fraction of moving thumbnail pixels in percent above which a pane changed
+	static const int MOTION_PERCENT = 1;
+
+	// callers capture at most MAX_CAPTURES frames, CAPTURE_INTERVAL_MS apart, before reading anyway
+	static const int MAX_CAPTURES = 6;
+	static const int CAPTURE_INTERVAL_MS = 50;
+
+private:
+	std::vector<cv::Rect2f> panes;
+	unsigned int required_frames;
+	std::chrono::milliseconds required_duration;
+
+	std::vector<cv::Mat> previous;
+	unsigned int stable_frames;
+	std::chrono::steady_clock::time_point last_motion;
+
+	static cv::Mat sample(const cv::Mat& pane);
+	static bool has_moved(const cv::Mat& previous, const cv::Mat& current);
+};
+
+}
@@ -15,10 +15,22 @@ statistics::statistics(image_recognition& recog)
 
 void statistics::update(const std::string& language, const cv::Mat& img)
 {
+	update(language, frame::create(img));
+}
+
+void statistics::update(const std::string& language, const frame::ptr& img)
+{
+	// both readers share the capture
 	stats_screen.update(language, img);
 	hud.update(language, img);
 }
 
+bool statistics::is_stable(const std::string& language, const frame::ptr& img)
+{
+	// the HUD does not animate, only wait for the statistics screen
+	return stats_screen.is_stable(language, img);
+}
+
 
 
 std::map<unsigned int, statistics_screen::properties> statistics::get_all()
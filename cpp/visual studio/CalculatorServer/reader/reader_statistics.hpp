@@ -17,6 +17,17 @@ public:
 	statistics(image_recognition& recog);
 
 	void update(const std::string& language, const cv::Mat& img);
+	/*
+	* Reads from @param{img} without copying it
+	*/
+	void update(const std::string& language, const frame::ptr& img);
+
+	/*
+	* Returns false while the panes of the statistics screen change between calls,
+	* e.g. during a tab switch. Frames without the statistics screen are always stable.
+	* Call with successive captures before update to skip intermediate frames.
+	*/
+	bool is_stable(const std::string& language, const frame::ptr& img);
 
 
 	/**
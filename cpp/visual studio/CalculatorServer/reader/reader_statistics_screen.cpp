@@ -57,32 +57,90 @@ statistics_screen::statistics_screen(image_recognition& recog)
 	:
 	recog(recog),
 	open_tab(tab::NONE),
+	multiple_islands_selected(false),
 	center_pane_selection(0),
-	selected_session(0)
+	selected_session(0),
+	islands_generation(0),
+	selection_generation(0),
+	gate({
+		statistics_screen_params::pane_title,
+		statistics_screen_params::pane_tabs,
+		statistics_screen_params::pane_islands,
+		statistics_screen_params::pane_finance_center,
+		statistics_screen_params::pane_finance_right,
+		statistics_screen_params::pane_production_center,
+		statistics_screen_params::pane_production_right,
+		statistics_screen_params::pane_population_center
+	}),
+	title_visible(false)
 {
 }
 
 
 void statistics_screen::update(const std::string& language, const cv::Mat& img)
 {
-	selected_island = std::string();
-	multiple_islands_selected = false;
-	selected_session = 0;
-	center_pane_selection = 0;
-	current_island_to_session.clear();
+	update(language, frame::create(img));
+}
+
+bool statistics_screen::is_stable(const std::string& language, const frame::ptr& img)
+{
+	if (img->empty())
+		return true;
+
+	recog.update(language, img->size());
+
+	if (!has_title(img))
+	{
+		gate.reset();
+		return true;
+	}
+
+	return gate.update(img->get_cropped());
+}
 
-	recog.update(language);
+bool statistics_screen::has_title(const frame::ptr& img)
+{
+	if (img != title_frame)
+	{
+		title_frame = img;
+		title_visible = recog.has_title(recog.get_pane(statistics_screen_params::pane_title, img->get_cropped()), phrase::STATISTICS);
+	}
+
+	return title_visible;
+}
+
+void statistics_screen::update(const std::string& language, const frame::ptr& img)
+{
+	auto reset_selection = [this]()
+	{
+		selected_island = std::string();
+		multiple_islands_selected = false;
+		selected_session = 0;
+		center_pane_selection = 0;
+		current_island_to_session.clear();
+		selection_generation = 0;
+	};
+
+	recog.update(language, img->size());
 
 	// test if open
-	cv::Mat cropped_image = recog.crop_widescreen(img);
+	const cv::Mat& cropped_image = img->get_cropped();
 
-	cv::Mat statistics_text_img = recog.binarize(recog.get_pane(statistics_screen_params::pane_title, cropped_image), true);
+	cv::Mat statistics_text_img = recog.get_pane(statistics_screen_params::pane_title, cropped_image);
 	if (recog.is_verbose()) {
 		cv::imwrite("debug_images/statistics_text.png", statistics_text_img);
 		cv::imwrite("debug_images/statistics_screenshot.png", cropped_image);
 	}
-	if (recog.get_guid_from_name(statistics_text_img, recog.make_dictionary({ phrase::STATISTICS })).empty())
+	// OCR only runs if the title does not match one recognized before
+	if (!has_title(img))
 	{
+		reset_selection();
+		// the game state may differ the next time the screen opens
+		factory_tables.clear();
+		finance_tables.clear();
+		changes.clear();
+		islands_generation = 0;
+		prev_islands.release();
 		open_tab = tab::NONE;
 		if (recog.is_verbose()) {
 			std::cout << std::endl;
@@ -94,27 +152,79 @@ void statistics_screen::update(const std::string& language, const cv::Mat& img)
 		std::cout << std::endl;
 	}
 
-	cropped_image.copyTo(this->screenshot);
+	current_frame = img;
+	screenshot = cropped_image;
+
+	// results read in another language must not be reused
+	if (language != changes_language)
+	{
+		changes.clear();
+		factory_rows.clear();
+		finance_rows.clear();
+		population_rows.clear();
+		workforce_rows.clear();
+		island_rows.clear();
+		factory_tables.clear();
+		finance_tables.clear();
+		changes_language = language;
+	}
+	changes.update(screenshot);
+
+	// the selected island is kept while the header and the buttons it is read from do not change
+	bool selection_changed =
+		changed_since(recog.get_pane(statistics_screen_params::pane_header_center, screenshot), selection_generation) ||
+		changed_since(recog.get_pane(statistics_screen_params::pane_all_islands, screenshot), selection_generation) ||
+		changed_since(recog.get_pane(statistics_screen_params::pane_tabs, screenshot), selection_generation);
+	if (selection_changed)
+		reset_selection();
 
+	tab previous_tab = open_tab;
 	open_tab = compute_open_tab();
+	// the remembered table lines belong to the previous island or tab
+	if (selection_changed || open_tab != previous_tab)
+		recog.clear_row_grids();
 	if (open_tab == tab::NONE)
-		return;
-	bool update = true;
-	if (prev_islands.size().area() == recog.get_pane(statistics_screen_params::pane_islands, screenshot).size().area())
 	{
-		cv::Mat diff;
-		cv::absdiff(recog.get_pane(statistics_screen_params::pane_islands, screenshot), prev_islands, diff);
-		std::cout << ((float)cv::sum(diff).ddot(cv::Scalar::ones())) << std::endl;
-		float match = ((float)cv::sum(diff).ddot(cv::Scalar::ones())) / prev_islands.rows / prev_islands.cols;
-		update = match > 30;
+		changes.clear();
+		islands_generation = 0;
+		prev_islands.release();
+		return;
 	}
-	if (update)
-	{ // island list changed
-		recog.get_pane(statistics_screen_params::pane_islands, screenshot).copyTo(prev_islands);
-		update_islands();
+
+	cv::Mat islands = recog.get_pane(statistics_screen_params::pane_islands, screenshot);
+	if (changed_since(islands, islands_generation))
+	{
+		islands_generation = changes.get_generation();
+
+		// tiles change with any pixel, keep the list on small differences
+		bool update = true;
+		if (prev_islands.size() == islands.size())
+		{
+			cv::Mat diff;
+			cv::absdiff(islands, prev_islands, diff);
+			update = cv::sum(diff).ddot(cv::Scalar::ones()) / islands.rows / islands.cols > 30;
+		}
+
+		if (update)
+		{ // island list changed
+			islands.copyTo(prev_islands);
+			update_islands();
+		}
 	}
 }
 
+bool statistics_screen::changed_since(const cv::Mat& pane, std::uint64_t generation) const
+{
+	if (pane.empty())
+		return false;
+
+	// locate the view by its offset in the buffer of screenshot
+	std::ptrdiff_t offset = pane.data - screenshot.data;
+	int y = static_cast<int>(offset / static_cast<std::ptrdiff_t>(screenshot.step));
+	int x = static_cast<int>(offset % static_cast<std::ptrdiff_t>(screenshot.step) / static_cast<std::ptrdiff_t>(screenshot.elemSize()));
+	return changes.changed_since(cv::Rect(x, y, pane.cols, pane.rows), generation);
+}
+
 bool statistics_screen::is_open() const
 {
 	return get_open_tab() != tab::NONE;
@@ -160,38 +270,55 @@ void statistics_screen::update_islands()
 		phrase::CAPE_TRELAWNEY,
 		phrase::ENBESA });
 
+	// convert once, the cells are binarized from the gray pane
+	cv::Mat gray_islands = image_recognition::to_gray(prev_islands);
+
 	recog.iterate_rows(prev_islands, 0.75f, [&](const cv::Mat& row) {
 		if (recog.is_verbose()) {
 			cv::imwrite("debug_images/row.png", row);
 		}
 
-		cv::Mat subheading = recog.binarize(recog.get_cell(row, 0.01f, 0.6f, 0.f), true);
+		// rows that only moved in the list are not read again
+		std::uint64_t hash = island_rows.hash(row);
+		island_row parsed{ 0 };
+		if (!island_rows.find(hash, parsed))
+		{
+			cv::Mat gray_row = image_recognition::get_corresponding_region(row, prev_islands, gray_islands);
+			cv::Mat subheading = recog.binarize(recog.get_cell(gray_row, 0.01f, 0.6f, 0.f), true, false);
 
-		if (recog.is_verbose()) {
-			cv::imwrite("debug_images/subheading.png", subheading);
-		}
+			if (recog.is_verbose()) {
+				cv::imwrite("debug_images/subheading.png", subheading);
+			}
 
-		std::vector<unsigned int> ids = recog.get_guid_from_name(subheading, phrases);
-		if (ids.size() == 1)
-		{
-			session_guid = ids.front();
-			return;
-		}
+			std::vector<unsigned int> ids = recog.get_guid_from_name(subheading, phrases);
+			if (ids.size() == 1)
+				parsed.heading_session = ids.front();
+			else
+			{
+				if (recog.is_verbose()) {
+					cv::imwrite("debug_images/selection_test.png", row(cv::Rect((int)(0.8f * row.cols), (int)(0.5f * row.rows), 10, 10)));
+				}
+
+				bool selected = is_selected(row.at<cv::Vec4b>((int)(0.5f * row.rows), (int)(0.8f * row.cols)));
+				cv::Mat island_name_image = recog.binarize(recog.get_cell(gray_row, 0.15f, 0.65f), selected, false);
 
+				if (recog.is_verbose()) {
+					cv::imwrite("debug_images/island_name.png", island_name_image);
+				}
 
+				parsed.island_name = recog.join(recog.detect_words(island_name_image), true);
+			}
 
-		if (recog.is_verbose()) {
-			cv::imwrite("debug_images/selection_test.png", row(cv::Rect((int)(0.8f * row.cols), (int)(0.5f * row.rows), 10, 10)));
+			island_rows.insert(hash, parsed);
 		}
 
-		bool selected = is_selected(row.at<cv::Vec4b>((int)(0.5f * row.rows), (int)(0.8f * row.cols)));
-		cv::Mat island_name_image = recog.binarize(recog.get_cell(row, 0.15f, 0.65f), selected);
-
-		if (recog.is_verbose()) {
-			cv::imwrite("debug_images/island_name.png", island_name_image);
+		if (parsed.heading_session)
+		{
+			session_guid = parsed.heading_session;
+			return;
 		}
 
-		std::string island_name = recog.join(recog.detect_words(island_name_image), true);
+		const std::string& island_name = parsed.island_name;
 		if (island_name.empty())
 			return;
 
@@ -209,8 +336,7 @@ void statistics_screen::update_islands()
 		session_guid = recog.get_session_guid(session_icon);
 
 		if (session_guid) {
-			island_to_session.emplace(island_name, session_guid);
-			current_island_to_session.emplace(island_name, session_guid);
+			add_island(island_name, session_guid);
 		}
 
 		if (recog.is_verbose()) {
@@ -239,13 +365,38 @@ bool statistics_screen::is_all_islands_selected() const
 
 std::pair<std::string, unsigned int> statistics_screen::get_island_from_list(std::string name) const
 {
-	for (const auto& entry : island_to_session)
-		if (recog.lcs_length(entry.first, name) > 0.66f * std::max(entry.first.size(), name.size()))
-			return entry;
+	const float threshold = 0.66f;
+
+	std::vector<std::size_t> candidates = island_index.find(name, [&](std::size_t island_length) {
+		return static_cast<int>(threshold * std::max(island_length, name.size()));
+	});
+
+	// return the first match in the order of island_to_session
+	const std::string* result = nullptr;
+	for (std::size_t id : candidates)
+	{
+		const std::string& island = island_index.get_keyword(id);
+		if (result && *result < island)
+			continue;
+
+		if (recog.lcs_length(island, name) > threshold * std::max(island.size(), name.size()))
+			result = &island;
+	}
+
+	if (result)
+		return *island_to_session.find(*result);
 
 	return std::make_pair(name, 0);
 }
 
+void statistics_screen::add_island(const std::string& name, unsigned int session) const
+{
+	if (island_to_session.emplace(name, session).second)
+		island_index.insert(name);
+
+	current_island_to_session.emplace(name, session);
+}
+
 cv::Mat statistics_screen::get_center_pane() const
 {
 	switch (get_open_tab())
@@ -325,6 +476,44 @@ bool statistics_screen::is_tab_selected(const cv::Vec4b& point)
 
 
 std::pair<unsigned int, int> statistics_screen::get_optimal_productivity()
+{
+	return reuse_unchanged(optimal_productivity, { get_right_pane() }, [this]() { return compute_optimal_productivity(); });
+}
+
+std::map<unsigned int, statistics_screen::properties> statistics_screen::get_factory_properties() const
+{
+	std::map<unsigned int, properties> visible = reuse_unchanged(factory_properties, { get_center_pane() }, [this]() { return compute_factory_properties(); });
+	if (open_tab != tab::PRODUCTION)
+		return visible;
+
+	// the table scrolls, return all rows seen so far
+	return stitch(factory_tables, visible);
+}
+
+std::map<unsigned int, int> statistics_screen::get_assets_existing_buildings_from_finance_screen() const
+{
+	// the names are filtered by the selected session
+	std::map<unsigned int, int> visible = reuse_unchanged(existing_buildings,
+		{ get_center_pane(), get_center_header(), get_right_header(), get_right_pane(), recog.get_pane(statistics_screen_params::pane_all_islands, screenshot) },
+		[this]() { return compute_assets_existing_buildings(); });
+	if (open_tab != tab::FINANCE || !center_pane_selection)
+		return visible;
+
+	// the table scrolls, return all rows seen so far
+	return stitch(finance_tables, visible);
+}
+
+std::map<unsigned int, statistics_screen::properties> statistics_screen::get_population_properties() const
+{
+	return reuse_unchanged(population_properties, { get_center_pane() }, [this]() { return compute_population_properties(); });
+}
+
+std::map<unsigned int, int> statistics_screen::get_population_workforce() const
+{
+	return reuse_unchanged(population_workforce, { get_center_pane() }, [this]() { return compute_population_workforce(); });
+}
+
+std::pair<unsigned int, int> statistics_screen::compute_optimal_productivity()
 {
 	const cv::Mat& im = screenshot;
 
@@ -373,33 +562,58 @@ std::pair<unsigned int, int> statistics_screen::get_optimal_productivity()
 		std::cout << std::endl;
 	}
 
-	std::vector<int> productivities;
-	recog.iterate_rows(roi, 0.8f, [&](const cv::Mat& row)
+	const std::vector<std::pair<float, float>> cells({ {0.6f, 0.2f}, {0.8f, 0.2f} });
+
+	// the productivity cells of all rows, read by a single batch
+	cv::Mat gray_roi = current_frame->get_gray(roi);
+	std::vector<std::vector<cv::Mat>> rows = recog.map_rows<std::vector<cv::Mat>>(roi, 0.8f, [&](const cv::Mat& row)
 		{
-			int productivity = 0;
-			for (const std::pair<float, float> cell : std::vector<std::pair<float, float>>({ {0.6f, 0.2f}, {0.8f, 0.2f} }))
+			cv::Mat gray_row = image_recognition::get_corresponding_region(row, roi, gray_roi);
+			std::vector<cv::Mat> texts;
+			for (const std::pair<float, float> cell : cells)
 			{
-				cv::Mat productivity_text = recog.binarize(recog.get_cell(row, cell.first, cell.second));
+				cv::Mat productivity_text = recog.binarize(recog.get_cell(gray_row, cell.first, cell.second), false, false);
 				if (recog.is_verbose()) {
 					cv::imwrite("debug_images/productivity_text.png", productivity_text);
 				}
-				int prod = recog.number_from_region(productivity_text);
-				if (prod > 1000) // sometimes '%' is detected as '0/0' or '00'
-					prod /= 100;
-
-				if (prod >= 0)
-					productivity += prod;
-				else
-					return;
+				texts.push_back(productivity_text);
 			}
 
-			if (recog.is_verbose()) {
-				std::cout << std::endl;
+			return texts;
+		});
+
+	std::vector<cv::Mat> productivity_texts;
+	for (const auto& row : rows)
+		productivity_texts.insert(productivity_texts.end(), row.begin(), row.end());
+
+	std::vector<int> prods = recog.numbers_from_regions(productivity_texts, digit_recognizer::PERCENTAGES);
+
+	std::vector<int> productivities;
+	for (std::size_t i = 0; i < rows.size(); i++)
+	{
+		int productivity = 0;
+		for (std::size_t c = 0; c < cells.size(); c++)
+		{
+			int prod = prods[i * cells.size() + c];
+			if (prod > 1000) // sometimes '%' is detected as '0/0' or '00'
+				prod /= 100;
+
+			if (prod < 0)
+			{
+				productivity = -1;
+				break;
 			}
 
+			productivity += prod;
+		}
+
+		if (productivity >= 0)
 			productivities.push_back(productivity);
+	}
 
-		});
+	if (recog.is_verbose()) {
+		std::cout << std::endl;
+	}
 
 	if (productivities.empty())
 		return std::make_pair(0, 0);
@@ -421,7 +635,7 @@ std::pair<unsigned int, int> statistics_screen::get_optimal_productivity()
 
 
 
-std::map<unsigned int, statistics_screen::properties> statistics_screen::get_factory_properties()
+std::map<unsigned int, statistics_screen::properties> statistics_screen::compute_factory_properties() const
 {
 	const cv::Mat& im = screenshot;
 
@@ -442,14 +656,32 @@ std::map<unsigned int, statistics_screen::properties> statistics_screen::get_fac
 		std::cout << "Average productivities" << std::endl;
 	}
 
-	recog.iterate_rows(roi, 0.9f, [&](const cv::Mat& row)
+	struct row_cells
+	{
+		std::uint64_t hash;
+		// true if parsed was read from an earlier frame
+		bool known;
+		factory_row parsed;
+		cv::Mat productivity_text;
+		cv::Mat output_text;
+	};
+
+	// convert once, the cells are binarized from the gray pane
+	cv::Mat gray_roi = current_frame->get_gray(roi);
+
+	std::vector<row_cells> rows = recog.map_rows<row_cells>(roi, 0.9f, [&](const cv::Mat& row)
 		{
-			properties props;
-		
 			if (recog.is_verbose()) {
 				cv::imwrite("debug_images/row.png", row);
 			}
 
+			row_cells cells{ factory_rows.hash(row), false };
+			if (factory_rows.find(cells.hash, cells.parsed))
+			{
+				cells.known = true;
+				return cells;
+			}
+
 			cv::Mat product_icon = recog.get_square_region(row, statistics_screen_params::position_factory_icon);
 			if (recog.is_verbose()) {
 				cv::imwrite("debug_images/factory_icon.png", product_icon);
@@ -458,60 +690,104 @@ std::map<unsigned int, statistics_screen::properties> statistics_screen::get_fac
 
 			std::vector<unsigned int> p_guids = recog.get_guid_from_icon(product_icon, recog.product_icons, background_color);
 			if (p_guids.empty())
-				return;
+				return cells;
 
 			if (recog.is_verbose()) {
 				try {
-					std::cout << recog.get_dictionary().products.at(p_guids.front()) << ":\t";
+					std::cout << recog.get_dictionary().products.at(p_guids.front()) << "\t";
 				}
 				catch (...) {}
 			}
 
 			bool selected = is_selected(row.at<cv::Vec4b>(0.1f * row.rows, 0.5f * row.cols));
-			cv::Mat productivity_text = recog.binarize(recog.get_cell(row, 0.7f, 0.1f, 0.4f), selected);
+			cv::Mat gray_row = image_recognition::get_corresponding_region(row, roi, gray_roi);
+			cv::Mat productivity_text = recog.binarize(recog.get_cell(gray_row, 0.7f, 0.1f, 0.4f), selected, false);
 			if (recog.is_verbose()) {
 				cv::imwrite("debug_images/productivity_text.png", productivity_text);
 			}
-			int prod = recog.number_from_region(productivity_text);
-
-			if (prod > 500 && prod % 100 == 0)
-				prod /= 100;
 
-			if (prod >= 0)
-				props.emplace(KEY_PRODUCTIVITY, prod);
-		
-			cv::Mat text_img = recog.binarize(recog.get_pane(statistics_screen_params::position_factory_output, row), true, true, 200);
+			cv::Mat text_img = recog.binarize(recog.get_pane(statistics_screen_params::position_factory_output, gray_row), true, false, 200);
 			if (recog.is_verbose()) {
 				cv::imwrite("debug_images/factory_output_text.png", text_img);
 			}
 
-			auto pair = recog.read_number_slash_number(text_img);
+			cells.parsed.product_guids = p_guids;
+			cells.productivity_text = productivity_text;
+			cells.output_text = text_img;
+			return cells;
+		});
 
-			if (pair.first >= 0)
-				props.emplace(KEY_AMOUNT, pair.first);
+	// read the numbers of all new rows from one page
+	std::vector<cv::Mat> texts;
+	for (const auto& row : rows)
+		if (!row.known && !row.parsed.product_guids.empty())
+		{
+			texts.push_back(row.productivity_text);
+			texts.push_back(row.output_text);
+		}
+
+	std::vector<cv::Rect> cells;
+	cv::Mat page = recog.compose_page(texts, cells);
+	std::vector<cv::Rect> productivity_cells;
+	std::vector<cv::Rect> output_cells;
+	for (std::size_t i = 0; i < cells.size(); i += 2)
+	{
+		productivity_cells.push_back(cells[i]);
+		output_cells.push_back(cells[i + 1]);
+	}
+
+	std::vector<int> prods = recog.numbers_from_cells(page, productivity_cells, digit_recognizer::PERCENTAGES);
+	std::vector<std::pair<int, int>> outputs = recog.read_numbers_slash_numbers(page, output_cells);
+
+	std::size_t index = 0;
+	for (auto& row : rows)
+	{
+		if (row.known)
+			continue;
+
+		if (!row.parsed.product_guids.empty())
+		{
+			int prod = prods[index];
+			auto pair = outputs[index];
+			index++;
+
+			if (prod > 500 && prod % 100 == 0)
+				prod /= 100;
 
-			if (pair.second >= 0 && pair.second >= pair.first)
-				props.emplace(KEY_LIMIT, pair.second);
-		
 			if (prod >= 0)
 			{
-				for (unsigned int p_guid : p_guids)
-					for (unsigned int f_guid : recog.product_to_factories[p_guid])
-						result.emplace(f_guid, props);
-			}
+				properties& props = row.parsed.props;
+				props.emplace(KEY_PRODUCTIVITY, prod);
 
+				if (pair.first >= 0)
+					props.emplace(KEY_AMOUNT, pair.first);
 
-			if (recog.is_verbose()) {
-				std::cout << std::endl;
+				if (pair.second >= 0 && pair.second >= pair.first)
+					props.emplace(KEY_LIMIT, pair.second);
 			}
+		}
 
-		});
+		factory_rows.insert(row.hash, row.parsed);
+	}
+
+	for (const auto& row : rows)
+	{
+		if (row.parsed.props.empty())
+			continue;
+
+		for (unsigned int p_guid : row.parsed.product_guids)
+			for (unsigned int f_guid : recog.product_to_factories[p_guid])
+				result.emplace(f_guid, row.parsed.props);
+	}
 
+	if (recog.is_verbose()) {
+		std::cout << std::endl;
+	}
 
 	return result;
 }
 
-std::map<unsigned int, int> statistics_screen::get_assets_existing_buildings_from_finance_screen()
+std::map<unsigned int, int> statistics_screen::compute_assets_existing_buildings() const
 {
 	std::map<unsigned int, int> result;
 
@@ -565,132 +841,167 @@ std::map<unsigned int, int> statistics_screen::get_assets_existing_buildings_fro
 	std::vector<unsigned int> prev_guids;
 	int prev_count = 0;
 
-	recog.iterate_rows(roi, 0.75f, [&](const cv::Mat& row)
-		{
-			if (recog.is_verbose()) {
-				cv::imwrite("debug_images/row.png", row);
-				cv::imwrite("debug_images/selection_test.png", row(cv::Rect((int)(0.037f * row.cols), (int)(0.5f * row.rows), 10, 10)));
-			}
-			bool is_summary_entry = image_recognition::closer_to(row.at<cv::Vec4b>(0.5f * row.rows, 0.037f * row.cols), statistics_screen_params::expansion_arrow, statistics_screen_params::background_brown_light);
+	std::vector<cv::Mat> rows = recog.get_rows(roi, 0.75f);
+	cv::Mat gray_roi = current_frame->get_gray(roi);
+	std::vector<bool> summary_entries;
+	// summary entries read on earlier frames
+	std::vector<std::uint64_t> hashes(rows.size(), 0);
+	std::vector<bool> known(rows.size(), false);
+	std::vector<finance_row> parsed(rows.size());
+	std::vector<cv::Mat> texts;
+	for (std::size_t i = 0; i < rows.size(); i++)
+	{
+		const cv::Mat& row = rows[i];
+		bool is_summary_entry = image_recognition::closer_to(row.at<cv::Vec4b>(0.5f * row.rows, 0.037f * row.cols), statistics_screen_params::expansion_arrow, statistics_screen_params::background_brown_light);
+		summary_entries.push_back(is_summary_entry);
 
-			if (is_summary_entry)
-			{
-				prev_guids.clear();
+		if (is_summary_entry)
+		{
+			// the dictionary depends on the selection in the right header
+			hashes[i] = finance_rows.hash(row) ^ static_cast<std::uint64_t>(center_pane_selection) << 40;
+			known[i] = finance_rows.find(hashes[i], parsed[i]);
+		}
 
-				cv::Mat text = recog.binarize(recog.get_cell(row, 0.15f, 0.5f));
+		cv::Mat gray_row = image_recognition::get_corresponding_region(row, roi, gray_roi);
+		texts.push_back(is_summary_entry && !known[i] ? recog.binarize(recog.get_cell(gray_row, 0.15f, 0.5f), false, false) : cv::Mat());
+	}
 
-				std::vector<unsigned int> guids = recog.get_guid_from_name(text, *dictionary);
+	// recognize the counts of all new summary entries from one page
+	std::vector<cv::Rect> cells;
+	cv::Mat page = recog.compose_page(texts, cells);
+	std::vector<std::vector<std::pair<std::string, cv::Rect>>> count_words = recog.detect_words_in_cells(page, cells, tesseract::PSM_SINGLE_LINE);
 
+	for (std::size_t i = 0; i < rows.size(); i++)
+	{
+		const cv::Mat& row = rows[i];
+		if (recog.is_verbose()) {
+			cv::imwrite("debug_images/row.png", row);
+			cv::imwrite("debug_images/selection_test.png", row(cv::Rect((int)(0.037f * row.cols), (int)(0.5f * row.rows), 10, 10)));
+		}
+		if (summary_entries[i])
+			prev_guids.clear();
 
-				if (recog.is_verbose()) {
-					try {
-						for (unsigned int guid : guids)
-							std::cout << dictionary->at(guid) << ", ";
-						std::cout << "\t";
-					}
-					catch (...) {}
-				}
+		if (summary_entries[i] && !known[i])
+		{
+			std::vector<unsigned int> guids = recog.get_guid_from_name(texts[i], *dictionary);
 
-				cv::Mat count_text = recog.binarize(recog.get_cell(row, 0.15f, 0.5f));
 
-				if (recog.is_verbose()) {
-					cv::imwrite("debug_images/count_text.png", count_text);
+			if (recog.is_verbose()) {
+				try {
+					for (unsigned int guid : guids)
+						std::cout << dictionary->at(guid) << ", ";
+					std::cout << "\t";
 				}
+				catch (...) {}
+			}
+
+			if (recog.is_verbose()) {
+				cv::imwrite("debug_images/count_text.png", texts[i]);
+			}
 
-				std::vector<std::pair<std::string, cv::Rect>> words = recog.detect_words(count_text, tesseract::PSM_SINGLE_LINE);
-				std::string number_string;
-				bool found_opening_bracket = false;
-				for (const auto& word : words)
+			const std::vector<std::pair<std::string, cv::Rect>>& words = count_words[i];
+			std::string number_string;
+			bool found_opening_bracket = false;
+			for (const auto& word : words)
+			{
+				if (found_opening_bracket)
+					number_string += word.first;
+				else
 				{
-					if (found_opening_bracket)
-						number_string += word.first;
-					else
+					std::vector<std::string> split_string;
+					boost::split(split_string, word.first, [](char c) {return c == '('; });
+					if (split_string.size() > 1)
 					{
-						std::vector<std::string> split_string;
-						boost::split(split_string, word.first, [](char c) {return c == '('; });
-						if (split_string.size() > 1)
-						{
-							found_opening_bracket = true;
-							number_string += split_string.back();
-						}
+						found_opening_bracket = true;
+						number_string += split_string.back();
 					}
 				}
+			}
 
-				number_string = std::regex_replace(number_string, std::regex("\\D"), "");
+			number_string = std::regex_replace(number_string, std::regex("\\D"), "");
+			if (recog.is_verbose()) {
+				std::cout << number_string;
+			}
+			int count = std::numeric_limits<int>::lowest();
+			try { count = std::stoi(number_string); }
+			catch (...) {
 				if (recog.is_verbose()) {
-					std::cout << number_string;
-				}
-				int count = std::numeric_limits<int>::lowest();
-				try { count = std::stoi(number_string); }
-				catch (...) {
-					if (recog.is_verbose()) {
-						std::cout << " (could not recognize number)";
-					}
+					std::cout << " (could not recognize number)";
 				}
+			}
 
-				if (count >= 0)
-				{
-					if (guids.size() != 1 && get_selected_session() && !is_all_islands_selected())
-						recog.filter_factories(guids, get_selected_session());
-
-					if (guids.size() != 1) {
-						cv::Mat product_icon = recog.get_square_region(row, statistics_screen_params::position_small_factory_icon);
-						if (recog.is_verbose()) {
-							cv::imwrite("debug_images/factory_icon.png", product_icon);
-						}
-						cv::Scalar background_color = statistics_screen_params::background_brown_light;
-						std::map<unsigned int, cv::Mat> icon_candidates;
-						for (unsigned int guid : guids)
-						{
-							auto iter = recog.factory_icons.find(guid);
-							if (iter != recog.factory_icons.end())
-								icon_candidates.insert(*iter);
-						}
-
-						guids = recog.get_guid_from_icon(product_icon, icon_candidates, background_color);
-					}
+			parsed[i] = finance_row{ guids, count };
+			finance_rows.insert(hashes[i], parsed[i]);
+		}
+
+		if (summary_entries[i])
+		{
+			std::vector<unsigned int> guids = parsed[i].guids;
+			int count = parsed[i].count;
+
+			if (count >= 0)
+			{
+				if (guids.size() != 1 && get_selected_session() && !is_all_islands_selected())
+					recog.filter_factories(guids, get_selected_session());
 
-					if (guids.size() == 1)
-						result.emplace(guids.front(), count);
-					else
+				if (guids.size() != 1) {
+					cv::Mat product_icon = recog.get_square_region(row, statistics_screen_params::position_small_factory_icon);
+					if (recog.is_verbose()) {
+						cv::imwrite("debug_images/factory_icon.png", product_icon);
+					}
+					cv::Scalar background_color = statistics_screen_params::background_brown_light;
+					std::map<unsigned int, cv::Mat> icon_candidates;
+					for (unsigned int guid : guids)
 					{
-						prev_guids = guids;
-						prev_count = count;
+						auto iter = recog.factory_icons.find(guid);
+						if (iter != recog.factory_icons.end())
+							icon_candidates.insert(*iter);
 					}
-				}
 
-			}
-			else if (!prev_guids.empty()) // no summary entry, test whether upper row is expanded
-			{
-				cv::Mat session_icon = recog.get_cell(row, 0.08f, 0.08f);
-				if (recog.is_verbose()) {
-					cv::imwrite("debug_images/session_icon.png", session_icon);
+					guids = recog.get_guid_from_icon(product_icon, icon_candidates, background_color);
 				}
 
-				unsigned int session_guid = recog.get_session_guid(session_icon);
-				if (!session_guid)
+				if (guids.size() == 1)
+					result.emplace(guids.front(), count);
+				else
 				{
-					// prev_guids.clear();
-					return;
+					prev_guids = guids;
+					prev_count = count;
 				}
+			}
 
-				recog.filter_factories(prev_guids, session_guid);
+		}
+		else if (!prev_guids.empty()) // no summary entry, test whether upper row is expanded
+		{
+			cv::Mat session_icon = recog.get_cell(row, 0.08f, 0.08f);
+			if (recog.is_verbose()) {
+				cv::imwrite("debug_images/session_icon.png", session_icon);
+			}
 
-				if (prev_guids.size() == 1)
-					result.emplace(prev_guids.front(), prev_count);
+			unsigned int session_guid = recog.get_session_guid(session_icon);
+			if (!session_guid)
+			{
+				// prev_guids.clear();
+				continue;
+			}
 
-				prev_guids.clear();
+			recog.filter_factories(prev_guids, session_guid);
 
-			}
-			if (recog.is_verbose()) {
-				std::cout << std::endl;
-			}
-		});
+			if (prev_guids.size() == 1)
+				result.emplace(prev_guids.front(), prev_count);
+
+			prev_guids.clear();
+
+		}
+		if (recog.is_verbose()) {
+			std::cout << std::endl;
+		}
+	}
 
 	return result;
 }
 
-std::map<unsigned int, statistics_screen::properties> statistics_screen::get_population_properties() const
+std::map<unsigned int, statistics_screen::properties> statistics_screen::compute_population_properties() const
 {
 	const cv::Mat& im = screenshot;
 
@@ -708,58 +1019,114 @@ std::map<unsigned int, statistics_screen::properties> statistics_screen::get_pop
 		cv::imwrite("debug_images/statistics_window_scroll_area.png", roi);
 	}
 
-	recog.iterate_rows(roi, 0.75f, [&](const cv::Mat& row)
+	struct row_cells
+	{
+		std::uint64_t hash;
+		// true if parsed was read from an earlier frame
+		bool known;
+		// (population level, properties), level 0 if the row could not be read
+		std::pair<unsigned int, properties> parsed;
+		cv::Mat amount_text;
+		cv::Mat houses_text;
+	};
+
+	// convert once, the cells are binarized from the gray pane
+	cv::Mat gray_roi = current_frame->get_gray(roi);
+
+	std::vector<row_cells> rows = recog.map_rows<row_cells>(roi, 0.75f, [&](const cv::Mat& row)
 		{
-			properties props;
+			row_cells cells{ population_rows.hash(row), false };
+			if (population_rows.find(cells.hash, cells.parsed))
+			{
+				cells.known = true;
+				return cells;
+			}
 
-			cv::Mat population_name = recog.binarize(recog.get_cell(row, 0.076f, 0.2f));
+			cv::Mat gray_row = image_recognition::get_corresponding_region(row, roi, gray_roi);
+			cv::Mat population_name = recog.binarize(recog.get_cell(gray_row, 0.076f, 0.2f), false, false);
 			if (recog.is_verbose()) {
 				cv::imwrite("debug_images/population_name.png", population_name);
 			}
 			std::vector<unsigned int> guids = recog.get_guid_from_name(population_name, recog.get_dictionary().population_levels);
 			if (guids.size() != 1)
-				return;
+				return cells;
 
-			// read amount and limit
-			cv::Mat text_img = recog.binarize(recog.get_cell(row, 0.5f, 0.27f, 0.4f));
 			if (recog.is_verbose()) {
-				cv::imwrite("debug_images/pop_amount_text.png", text_img);
+				try {
+					std::cout << recog.get_dictionary().population_levels.at(guids.front()) << std::endl;
+				}
+				catch (...) {}
 			}
 
+			// amount and limit
+			cv::Mat amount_text = recog.binarize(recog.get_cell(gray_row, 0.5f, 0.27f, 0.4f), false, false);
+			if (recog.is_verbose()) {
+				cv::imwrite("debug_images/pop_amount_text.png", amount_text);
+			}
 
+			// existing buildings
+			cv::Mat houses_text = recog.binarize(recog.get_cell(gray_row, 0.3f, 0.15f, 0.4f), false, false);
 			if (recog.is_verbose()) {
-				try {
-					std::cout << recog.get_dictionary().population_levels.at(guids.front()) << "\t";
-				}
-				catch (...) {}
+				cv::imwrite("debug_images/pop_houses_text.png", houses_text);
 			}
 
-			auto pair = recog.read_number_slash_number(text_img);
+			cells.parsed.first = guids.front();
+			cells.amount_text = amount_text;
+			cells.houses_text = houses_text;
+			return cells;
+		});
 
+	// read the numbers of all new rows from one page
+	std::vector<cv::Mat> texts;
+	for (const auto& row : rows)
+		if (!row.known && row.parsed.first)
+		{
+			texts.push_back(row.amount_text);
+			texts.push_back(row.houses_text);
+		}
 
+	std::vector<cv::Rect> cells;
+	cv::Mat page = recog.compose_page(texts, cells);
+	std::vector<cv::Rect> amount_cells;
+	std::vector<cv::Rect> houses_cells;
+	for (std::size_t i = 0; i < cells.size(); i += 2)
+	{
+		amount_cells.push_back(cells[i]);
+		houses_cells.push_back(cells[i + 1]);
+	}
+
+	std::vector<std::pair<int, int>> amounts = recog.read_numbers_slash_numbers(page, amount_cells);
+	std::vector<int> houses = recog.numbers_from_cells(page, houses_cells);
+
+	std::size_t index = 0;
+	for (auto& row : rows)
+	{
+		if (row.known)
+			continue;
+
+		if (row.parsed.first)
+		{
+			auto pair = amounts[index];
+			int house_count = houses[index];
+			index++;
+
+			properties& props = row.parsed.second;
 			if (pair.first >= 0)
 				props.emplace(KEY_AMOUNT, pair.first);
 
 			if (pair.second >= 0 && pair.second >= pair.first)
 				props.emplace(KEY_LIMIT, pair.second);
 
-			// read existing buildings
-			text_img = recog.binarize(recog.get_cell(row, 0.3f, 0.15f, 0.4f));
-			if (recog.is_verbose()) {
-				cv::imwrite("debug_images/pop_houses_text.png", text_img);
-			}
-			int houses = recog.number_from_region(text_img);
-
-			if (houses >= 0)
-				props.emplace(KEY_EXISTING_BUILDINGS, houses);
+			if (house_count >= 0)
+				props.emplace(KEY_EXISTING_BUILDINGS, house_count);
+		}
 
-			if (recog.is_verbose()) {
-				std::cout << std::endl;
-			}
+		population_rows.insert(row.hash, row.parsed);
+	}
 
-			if (!props.empty())
-				result.emplace(guids.front(), props);
-		});
+	for (const auto& row : rows)
+		if (row.parsed.first && !row.parsed.second.empty())
+			result.emplace(row.parsed.first, row.parsed.second);
 
 	if (result.size() < 6)
 		for (const auto& entry : recog.get_dictionary().population_levels)
@@ -786,11 +1153,13 @@ std::map<std::string, unsigned int> statistics_screen::get_current_islands() con
 	return current_island_to_session;
 }
 
-std::string statistics_screen::get_selected_island()
+std::string statistics_screen::get_selected_island() const
 {
 	if (!selected_island.empty() || multiple_islands_selected)
 		return selected_island;
 
+	selection_generation = changes.get_generation();
+
 	if (is_all_islands_selected())
 	{
 		if (recog.is_verbose()) {
@@ -868,8 +1237,7 @@ std::string statistics_screen::get_selected_island()
 	if (session_result.size())
 	{
 		selected_session = session_result[0];
-		island_to_session.emplace(selected_island, selected_session);
-		current_island_to_session.emplace(selected_island, selected_session);
+		add_island(selected_island, selected_session);
 	}
 
 	if (recog.is_verbose()) {
@@ -878,7 +1246,7 @@ std::string statistics_screen::get_selected_island()
 	return selected_island;
 }
 
-unsigned int statistics_screen::get_selected_session()
+unsigned int statistics_screen::get_selected_session() const
 {
 	get_selected_island(); // update island information
 	return selected_session;
@@ -887,7 +1255,7 @@ unsigned int statistics_screen::get_selected_session()
 
 
 
-std::map<unsigned int, int> statistics_screen::get_population_workforce() const
+std::map<unsigned int, int> statistics_screen::compute_population_workforce() const
 {
 	const cv::Mat& im = screenshot;
 
@@ -905,27 +1273,70 @@ std::map<unsigned int, int> statistics_screen::get_population_workforce() const
 		cv::imwrite("debug_images/statistics_window_scroll_area.png", roi);
 	}
 
-	recog.iterate_rows(roi, 0.75f, [&](const cv::Mat& row)
+	struct row_cells
+	{
+		std::uint64_t hash;
+		// true if parsed was read from an earlier frame
+		bool known;
+		// (population level, workforce), level 0 if the row could not be read
+		std::pair<unsigned int, int> parsed;
+		cv::Mat workforce_text;
+	};
+
+	// convert once, the cells are binarized from the gray pane
+	cv::Mat gray_roi = current_frame->get_gray(roi);
+
+	std::vector<row_cells> rows = recog.map_rows<row_cells>(roi, 0.75f, [&](const cv::Mat& row)
 		{
-			cv::Mat population_name = recog.binarize(recog.get_cell(row, 0.076f, 0.2f));
+			row_cells cells{ workforce_rows.hash(row), false, { 0, -1 } };
+			if (workforce_rows.find(cells.hash, cells.parsed))
+			{
+				cells.known = true;
+				return cells;
+			}
+
+			cv::Mat gray_row = image_recognition::get_corresponding_region(row, roi, gray_roi);
+			cv::Mat population_name = recog.binarize(recog.get_cell(gray_row, 0.076f, 0.2f), false, false);
 			if (recog.is_verbose()) {
 				cv::imwrite("debug_images/population_name.png", population_name);
 			}
 			std::vector<unsigned int> guids = recog.get_guid_from_name(population_name, recog.get_dictionary().population_levels);
 			if (guids.size() != 1)
-				return;
+				return cells;
 
-			cv::Mat text_img = recog.binarize(recog.get_cell(row, 0.8f, 0.1f));
+			cv::Mat text_img = recog.binarize(recog.get_cell(gray_row, 0.8f, 0.1f), false, false);
 			if (recog.is_verbose()) {
 				cv::imwrite("debug_images/pop_houses_text.png", text_img);
 			}
-			int workforce = recog.number_from_region(text_img);
-
-			if (workforce >= 0)
-				result.emplace(guids.front(), workforce);
 
+			cells.parsed.first = guids.front();
+			cells.workforce_text = text_img;
+			return cells;
 		});
 
+	std::vector<cv::Mat> texts;
+	for (const auto& row : rows)
+		if (!row.known && row.parsed.first)
+			texts.push_back(row.workforce_text);
+
+	std::vector<int> workforce = recog.numbers_from_regions(texts);
+
+	std::size_t index = 0;
+	for (auto& row : rows)
+	{
+		if (row.known)
+			continue;
+
+		if (row.parsed.first)
+			row.parsed.second = workforce[index++];
+
+		workforce_rows.insert(row.hash, row.parsed);
+	}
+
+	for (const auto& row : rows)
+		if (row.parsed.first && row.parsed.second >= 0)
+			result.emplace(row.parsed.first, row.parsed.second);
+
 	for (const auto& entry : recog.get_dictionary().population_levels)
 	{
 		if (result.find(entry.first) == result.end())
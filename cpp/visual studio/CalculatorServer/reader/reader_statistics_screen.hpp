@@ -1,5 +1,10 @@
 #pragma once
 
+#include <chrono>
+
+#include "reader_change_detection.hpp"
+#include "reader_stability_gate.hpp"
+#include "reader_row_memo.hpp"
 #include "reader_util.hpp"
 
 namespace reader
@@ -65,6 +70,17 @@ public:
 	statistics_screen(image_recognition& recog);
 
 	void update(const std::string& language, const cv::Mat& img);
+	/*
+	* Reads from @param{img} without copying it
+	*/
+	void update(const std::string& language, const frame::ptr& img);
+
+	/*
+	* Returns false while the panes of the statistics screen change between calls,
+	* e.g. during a tab switch. Frames without the statistics screen are always stable.
+	* The title check is reused by a following update with the same @param{img}.
+	*/
+	bool is_stable(const std::string& language, const frame::ptr& img);
 
 	
 
@@ -75,16 +91,21 @@ public:
 
 	/*
 	* Returns percentile productivity for factories.
+	* Includes the rows that were scrolled out of view less than MAX_ROW_AGE_MS ago.
 	* Returns an empty map in case no information is found.
 	*/
-	std::map < unsigned int, properties> get_factory_properties();
+	std::map < unsigned int, properties> get_factory_properties() const;
 	std::pair < unsigned int, int> get_optimal_productivity();
 
 	/*
 	* Returns count of existing buildings (houses/factories).
+	* Includes the rows that were scrolled out of view less than MAX_ROW_AGE_MS ago.
 	* Returns an empty map in case no information is found.
 	*/
-	std::map < unsigned int, int> get_assets_existing_buildings_from_finance_screen();
+	std::map < unsigned int, int> get_assets_existing_buildings_from_finance_screen() const;
+
+	// rows scrolled out of view are dropped after this duration, the game values change meanwhile
+	static const int MAX_ROW_AGE_MS = 30000;
 
 	std::map<unsigned int, int> get_population_workforce() const;
 
@@ -93,8 +114,8 @@ public:
 * the statistics screen
 * Returns ALL_ISLANDS
 */
-	std::string get_selected_island();
-	unsigned int get_selected_session();
+	std::string get_selected_island() const;
+	unsigned int get_selected_session() const;
 
 
 	/*
@@ -116,6 +137,11 @@ public:
 	*/
 	std::pair<std::string, unsigned int> get_island_from_list(std::string name) const;
 
+	/*
+	* Stores the island in @ref{island_to_session} and @ref{current_island_to_session}
+	*/
+	void add_island(const std::string& name, unsigned int session) const;
+
 	/*
 	* Returns the panes dependent on the opened tab
 	* Empty image, if !is_open or no position info for pane
@@ -136,23 +162,178 @@ private:
 	cv::Mat prev_islands;
 	tab open_tab;
 
+	// screenshot is the cropped view of current_frame
+	frame::ptr current_frame;
 	cv::Mat screenshot;
 
-	std::map<std::string, unsigned int> island_to_session;
-	std::map<std::string, unsigned int> current_island_to_session;
+	stability_gate gate;
+	// last frame whose title was checked and the result, see has_title
+	frame::ptr title_frame;
+	bool title_visible;
+
+	/*
+	* Whether the title of the statistics screen is visible in @param{img},
+	* checked once per frame
+	*/
+	bool has_title(const frame::ptr& img);
+
+	// filled while reading, also by the accessors
+	mutable std::map<std::string, unsigned int> island_to_session;
+	mutable std::map<std::string, unsigned int> current_island_to_session;
+	// names of island_to_session, used by get_island_from_list
+	mutable ngram_index island_index;
 
 	// empty if not yet evaluated, use get_selected_island()
-	std::string selected_island;
-	bool multiple_islands_selected;
+	mutable std::string selected_island;
+	mutable bool multiple_islands_selected;
 
 	// use get_selected_session()
-	unsigned int selected_session;
-	unsigned int center_pane_selection;
+	mutable unsigned int selected_session;
+	mutable unsigned int center_pane_selection;
 
 	
+	// tiles of the statistics window in consecutive frames while it is open
+	tile_change_detector changes;
+	std::string changes_language;
+	// generation in which the island list and the selected island were read
+	std::uint64_t islands_generation;
+	mutable std::uint64_t selection_generation;
+
+	template <typename T>
+	struct cached_result
+	{
+		// generation of changes the value was read in, 0 if none
+		std::uint64_t generation = 0;
+		T value;
+	};
+
+	mutable cached_result<std::pair<unsigned int, int>> optimal_productivity;
+	mutable cached_result<std::map<unsigned int, properties>> factory_properties;
+	mutable cached_result<std::map<unsigned int, int>> existing_buildings;
+	mutable cached_result<std::map<unsigned int, properties>> population_properties;
+	mutable cached_result<std::map<unsigned int, int>> population_workforce;
+
+	/*
+	* Parsed table rows by the hash of their pixels, see row_memo
+	*/
+	struct factory_row
+	{
+		std::vector<unsigned int> product_guids;
+		// empty if the row could not be read
+		properties props;
+	};
+
+	struct finance_row
+	{
+		// matches of the name before filtering by session
+		std::vector<unsigned int> guids;
+		int count;
+	};
+
+	struct island_row
+	{
+		// session of a subheading, 0 for island rows
+		unsigned int heading_session;
+		std::string island_name;
+	};
+
+	mutable row_memo<factory_row> factory_rows;
+	mutable row_memo<finance_row> finance_rows;
+	// (population level, properties), level 0 if the row could not be read
+	mutable row_memo<std::pair<unsigned int, properties>> population_rows;
+	// (population level, workforce), level 0 if the row could not be read
+	mutable row_memo<std::pair<unsigned int, int>> workforce_rows;
+	mutable row_memo<island_row> island_rows;
+
+	template <typename T>
+	struct stitched_row
+	{
+		T value;
+		// last time the row was visible
+		std::chrono::steady_clock::time_point seen;
+	};
+
+	/*
+	* Rows of the scrolling tables seen since the statistics screen was opened,
+	* by selected island, tab and category of the finance tab
+	*/
+	typedef std::tuple<std::string, tab, unsigned int> table_key;
+	mutable std::map<table_key, std::map<unsigned int, stitched_row<properties>>> factory_tables;
+	mutable std::map<table_key, std::map<unsigned int, stitched_row<int>>> finance_tables;
+
+	/*
+	* Merges @param{visible} into the table of the current selection and returns it.
+	* Rows are identified by their GUID, the visible values replace older ones.
+	* Rows not visible for more than MAX_ROW_AGE_MS are dropped.
+	* Returns @param{visible} if the selected island is unknown.
+	*/
+	template <typename T>
+	std::map<unsigned int, T> stitch(std::map<table_key, std::map<unsigned int, stitched_row<T>>>& tables,
+		const std::map<unsigned int, T>& visible) const
+	{
+		std::string island = get_selected_island();
+		if (island.empty())
+			return visible;
+
+		const auto now = std::chrono::steady_clock::now();
+		std::map<unsigned int, stitched_row<T>>& table = tables[table_key(island, open_tab, center_pane_selection)];
+		for (const auto& entry : visible)
+			table[entry.first] = stitched_row<T>{ entry.second, now };
+
+		std::map<unsigned int, T> result;
+		for (auto iter = table.begin(); iter != table.end();)
+		{
+			if (now - iter->second.seen > std::chrono::milliseconds(MAX_ROW_AGE_MS))
+			{
+				iter = table.erase(iter);
+				continue;
+			}
+
+			result.emplace(iter->first, iter->second.value);
+			++iter;
+		}
+
+		return result;
+	}
+
+	/*
+	* Tests whether a tile overlapping @param{pane}, a view into screenshot,
+	* changed after @param{generation}
+	*/
+	bool changed_since(const cv::Mat& pane, std::uint64_t generation) const;
+
+	/*
+	* Returns the value of @param{cache} if neither the tabs nor one of @param{panes}
+	* (the views into screenshot that @param{read} evaluates) changed since it was read,
+	* otherwise stores and returns the result of @param{read}
+	*/
+	template <typename T, typename Function>
+	T reuse_unchanged(cached_result<T>& cache, std::initializer_list<cv::Mat> panes, Function read) const
+	{
+		if (!is_open())
+			return read();
+
+		bool changed = changed_since(recog.get_pane(statistics_screen_params::pane_tabs, screenshot), cache.generation);
+		for (const cv::Mat& pane : panes)
+			changed = changed || changed_since(pane, cache.generation);
+
+		if (!changed)
+			return cache.value;
+
+		cache.value = read();
+		cache.generation = changes.get_generation();
+		return cache.value;
+	}
+
 	tab compute_open_tab() const;
 	void update_islands();
 
+	std::pair<unsigned int, int> compute_optimal_productivity();
+	std::map<unsigned int, properties> compute_factory_properties() const;
+	std::map<unsigned int, int> compute_assets_existing_buildings() const;
+	std::map<unsigned int, properties> compute_population_properties() const;
+	std::map<unsigned int, int> compute_population_workforce() const;
+
 
 };
 
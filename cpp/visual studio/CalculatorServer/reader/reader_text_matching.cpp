@@ -0,0 +1,253 @@
+#include "reader_text_matching.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace reader
+{
+
+////////////////////////////////////////
+//
+// Class: lcs_pattern
+//
+////////////////////////////////////////
+
+lcs_pattern::lcs_pattern(const std::string& pattern)
+	:
+	length(pattern.size()),
+	blocks((pattern.size() + 63) / 64),
+	masks(256 * ((pattern.size() + 63) / 64), 0)
+{
+	for (std::size_t i = 0; i < length; i++)
+	{
+		unsigned char c = static_cast<unsigned char>(pattern[i]);
+		masks[c * blocks + i / 64] |= std::uint64_t(1) << (i % 64);
+	}
+}
+
+int lcs_pattern::lcs_length(const std::string& text) const
+{
+	if (!length || text.empty())
+		return 0;
+
+	// bit i of row is cleared iff the LCS grows at pattern position i (Hyyroe 2004)
+	// bits beyond the pattern length remain set because their masks are empty
+	std::vector<std::uint64_t> row(blocks, ~std::uint64_t(0));
+
+	for (char t : text)
+	{
+		const std::uint64_t* match = masks.data() + static_cast<unsigned char>(t) * blocks;
+		std::uint64_t carry = 0;
+
+		for (std::size_t k = 0; k < blocks; k++)
+		{
+			std::uint64_t v = row[k];
+			std::uint64_t u = v & match[k];
+
+			std::uint64_t sum = v + carry;
+			std::uint64_t next_carry = sum < carry;
+			sum += u;
+			next_carry |= sum < u;
+			carry = next_carry;
+
+			row[k] = sum | (v & ~match[k]);
+		}
+	}
+
+	int result = 0;
+	for (std::uint64_t v : row)
+	{
+		// count cleared bits
+		for (v = ~v; v; v &= v - 1)
+			result++;
+	}
+
+	return result;
+}
+
+std::size_t lcs_pattern::size() const
+{
+	return length;
+}
+
+////////////////////////////////////////
+//
+// Class: ngram_index
+//
+////////////////////////////////////////
+
+std::size_t ngram_index::insert(const std::string& keyword)
+{
+	std::size_t id = keywords.size();
+	keywords.push_back(keyword);
+
+	for (const auto& gram : count_ngrams(keyword))
+		postings[gram.first].emplace_back(id, gram.second);
+
+	return id;
+}
+
+std::vector<std::size_t> ngram_index::find(const std::string& text,
+	const std::function<int(std::size_t)>& min_lcs_length) const
+{
+	std::vector<int> common(keywords.size(), 0);
+	for (const auto& gram : count_ngrams(text))
+	{
+		auto iter = postings.find(gram.first);
+		if (iter == postings.end())
+			continue;
+
+		for (const auto& posting : iter->second)
+			common[posting.first] += std::min(gram.second, posting.second);
+	}
+
+	std::vector<std::size_t> result;
+	for (std::size_t id = 0; id < keywords.size(); id++)
+	{
+		std::size_t length = keywords[id].size();
+		if (common[id] >= min_common_ngrams(length, text.size(), min_lcs_length(length)))
+			result.push_back(id);
+	}
+
+	return result;
+}
+
+const std::string& ngram_index::get_keyword(std::size_t id) const
+{
+	return keywords.at(id);
+}
+
+std::size_t ngram_index::size() const
+{
+	return keywords.size();
+}
+
+void ngram_index::clear()
+{
+	keywords.clear();
+	postings.clear();
+}
+
+int ngram_index::min_common_ngrams(std::size_t a, std::size_t b, int lcs_length)
+{
+	const int n = static_cast<int>(N);
+	const int len_a = static_cast<int>(a);
+	const int len_b = static_cast<int>(b);
+
+	// transform either string into the other via the LCS, the untouched n-grams remain
+	int from_a = len_a - n + 1 - n * (len_a - lcs_length) - (n - 1) * (len_b - lcs_length);
+	int from_b = len_b - n + 1 - n * (len_b - lcs_length) - (n - 1) * (len_a - lcs_length);
+
+	return std::max(0, std::max(from_a, from_b));
+}
+
+std::vector<std::pair<ngram_index::ngram, int>> ngram_index::count_ngrams(const std::string& text)
+{
+	std::vector<ngram> grams;
+	if (text.size() >= N)
+		grams.reserve(text.size() - N + 1);
+
+	for (std::size_t i = 0; i + N <= text.size(); i++)
+	{
+		ngram gram = 0;
+		for (std::size_t k = 0; k < N; k++)
+			gram = gram << 8 | static_cast<unsigned char>(text[i + k]);
+		grams.push_back(gram);
+	}
+	std::sort(grams.begin(), grams.end());
+
+	std::vector<std::pair<ngram, int>> result;
+	for (ngram gram : grams)
+	{
+		if (result.empty() || result.back().first != gram)
+			result.emplace_back(gram, 1);
+		else
+			result.back().second++;
+	}
+
+	return result;
+}
+
+////////////////////////////////////////
+//
+// Class: text_matcher
+//
+////////////////////////////////////////
+
+text_matcher::text_matcher(const std::map<unsigned int, std::string>& dictionary)
+{
+	guids.reserve(dictionary.size());
+	for (const auto& entry : dictionary)
+	{
+		guids.push_back(entry.first);
+		index.insert(normalize(entry.second));
+	}
+}
+
+std::vector<unsigned int> text_matcher::find(const std::string& text) const
+{
+	std::vector<unsigned int> result;
+	float best_match = 0.f;
+
+	// the text is the same for all keywords, compile it once
+	lcs_pattern pattern(text);
+
+	std::vector<std::size_t> candidates = index.find(text, [&](std::size_t keyword_length) {
+		return min_lcs_length(keyword_length, text.size());
+	});
+
+	for (std::size_t id : candidates)
+	{
+		const std::string& kw = index.get_keyword(id);
+
+		float total_length = std::max(kw.size(), text.size());
+		int min_lcs_length = text_matcher::min_lcs_length(kw.size(), text.size());
+
+		// the LCS cannot be longer than the shorter string, skip keywords that cannot compete
+		int max_lcs_length = static_cast<int>(std::min(kw.size(), text.size()));
+		if (max_lcs_length < min_lcs_length || max_lcs_length / total_length < best_match)
+			continue;
+
+		int lcs_length = pattern.lcs_length(kw);
+		float match = lcs_length / total_length;
+
+		if (lcs_length >= min_lcs_length)
+		{
+			if (match == best_match)
+			{
+				result.push_back(guids[id]);
+			}
+			else if (match > best_match)
+			{
+				result.clear();
+				result.push_back(guids[id]);
+				best_match = match;
+			}
+		}
+	}
+
+	return result;
+}
+
+std::size_t text_matcher::size() const
+{
+	return guids.size();
+}
+
+std::string text_matcher::normalize(const std::string& text)
+{
+	std::string result;
+	result.reserve(text.size());
+	for (char c : text)
+		if (c != ' ')
+			result.push_back(c);
+	return result;
+}
+
+int text_matcher::min_lcs_length(std::size_t keyword_length, std::size_t text_length)
+{
+	float total_length = std::max(keyword_length, text_length);
+	return total_length - static_cast<int>(std::roundf(-0.677f + 1.51 * std::logf(total_length)));
+}
+
+}
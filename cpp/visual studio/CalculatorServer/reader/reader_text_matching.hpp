@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace reader
+{
+
+/*
+* Bit-parallel longest common subsequence of one fixed string (the pattern)
+* against arbitrary strings. Each character of the pattern corresponds to one bit,
+* one machine word covers 64 characters.
+*/
+class lcs_pattern
+{
+public:
+	lcs_pattern(const std::string& pattern);
+
+	/*
+	* Returns the length of the longest common subsequence of the pattern and @param{text}
+	*/
+	int lcs_length(const std::string& text) const;
+
+	std::size_t size() const;
+
+private:
+	std::size_t length;
+	std::size_t blocks;
+	// (character, block) -> bits set at the positions where the pattern contains the character
+	std::vector<std::uint64_t> masks;
+};
+
+/*
+* Inverted index from n-grams (N consecutive bytes) to the keywords containing them.
+* Used to discard keywords that cannot reach a minimum LCS length with a text
+* before the LCS is computed.
+*/
+class ngram_index
+{
+public:
+	static const std::size_t N = 2;
+
+	/*
+	* Adds @param{keyword} and returns its id, ids are assigned consecutively from 0
+	*/
+	std::size_t insert(const std::string& keyword);
+
+	/*
+	* Returns the ids (ascending) of all keywords that share enough n-grams with @param{text}
+	* to possibly have an LCS length of at least @param{min_lcs_length}(keyword length).
+	* All other keywords have a shorter LCS with @param{text}.
+	*/
+	std::vector<std::size_t> find(const std::string& text,
+		const std::function<int(std::size_t)>& min_lcs_length) const;
+
+	const std::string& get_keyword(std::size_t id) const;
+	std::size_t size() const;
+	void clear();
+
+	/*
+	* Lower bound for the number of n-grams (counted with multiplicity) two strings
+	* of lengths @param{a} and @param{b} share if their LCS has length @param{lcs_length}.
+	* Deleting a character from one string destroys at most N of its n-grams,
+	* inserting one into the other at most N - 1.
+	*/
+	static int min_common_ngrams(std::size_t a, std::size_t b, int lcs_length);
+
+private:
+	typedef std::uint32_t ngram;
+
+	/*
+	* Returns (n-gram, number of occurrences) of @param{text}, sorted by n-gram
+	*/
+	static std::vector<std::pair<ngram, int>> count_ngrams(const std::string& text);
+
+	std::vector<std::string> keywords;
+	// n-gram -> (keyword id, number of occurrences)
+	std::map<ngram, std::vector<std::pair<std::size_t, int>>> postings;
+};
+
+/*
+* Matches recognized text against a fixed dictionary (GUID -> name)
+* The keywords are normalized (spaces removed) and indexed once on construction.
+*/
+class text_matcher
+{
+public:
+	text_matcher(const std::map<unsigned int, std::string>& dictionary);
+
+	/*
+	* Returns the GUIDs of the keywords with the highest relative LCS length to @param{text}
+	* Keywords whose LCS length falls below a length dependent threshold are ignored.
+	* Returns an empty vector if no keyword matches.
+	*/
+	std::vector<unsigned int> find(const std::string& text) const;
+
+	std::size_t size() const;
+
+	/*
+	* Removes all spaces from @param{text}
+	*/
+	static std::string normalize(const std::string& text);
+
+	/*
+	* Minimum LCS length for a keyword to be accepted by find
+	*/
+	static int min_lcs_length(std::size_t keyword_length, std::size_t text_length);
+
+private:
+	std::vector<unsigned int> guids;
+	// keyword ids equal the indices into guids
+	ngram_index index;
+};
+
+}
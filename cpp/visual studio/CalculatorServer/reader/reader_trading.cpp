@@ -71,7 +71,14 @@ trading_menu::trading_menu(image_recognition& recog)
 	recog(recog),
 	storage_icon(recog.binarize_icon(image_recognition::load_image("icons/icon_goods_storage.png"))),
 	open_trader(0),
-	menu_open(false)
+	menu_open(false),
+	gate({
+		trading_params::pane_menu_title,
+		trading_params::pane_menu_name,
+		trading_params::pane_menu_offering_with_counter,
+		trading_params::pane_menu_ship_sockets
+	}),
+	title_visible(false)
 {
 	for (const auto& item : recog.items)
 		if (item.second->isShipAllocation())
@@ -79,26 +86,64 @@ trading_menu::trading_menu(image_recognition& recog)
 }
 
 void trading_menu::update(const std::string& language, const cv::Mat& img)
+{
+	update(language, frame::create(img));
+}
+
+bool trading_menu::is_stable(const std::string& language, const frame::ptr& img)
+{
+	if (img->empty())
+		return true;
+
+	recog.update(language, img->size());
+
+	if (!has_title(img))
+	{
+		gate.reset();
+		return true;
+	}
+
+	return gate.update(img->get_cropped());
+}
+
+bool trading_menu::has_title(const frame::ptr& img)
+{
+	if (img != title_frame)
+	{
+		title_frame = img;
+		title_visible = recog.has_title(recog.get_pane(trading_params::pane_menu_title, img->get_cropped()), phrase::TRADE);
+	}
+
+	return title_visible;
+}
+
+void trading_menu::update(const std::string& language, const frame::ptr& img)
 {
 	open_trader = 0;
 	menu_open = false;
 
-	if (!img.cols)
+	if (img->empty())
 		return;
 
-	recog.crop_widescreen(img).copyTo(this->screenshot);
-	window_width = img.cols;
-	recog.update(language);
+	current_frame = img;
+	screenshot = img->get_cropped();
+	window_width = img->size().width;
+	recog.update(language, img->size());
 
 
 	// test if trading menu is open
-	cv::Mat trading_menu_title = recog.binarize(recog.get_pane(trading_params::pane_menu_title, screenshot), true);
+	cv::Mat trading_menu_title = recog.get_pane(trading_params::pane_menu_title, screenshot);
 
 	if (recog.is_verbose()) {
 		cv::imwrite("debug_images/trading_menu_title.png", trading_menu_title);
 	}
 
-	menu_open = !recog.get_guid_from_name(trading_menu_title, recog.make_dictionary({ phrase::TRADE })).empty();
+	// OCR only runs if the title does not match one recognized before
+	menu_open = has_title(img);
+
+	// another ship may be selected the next time the menu opens
+	if (!menu_open)
+		socket_boxes.clear();
 
 	if (menu_open)
 	{
@@ -208,59 +253,28 @@ bool trading_menu::is_ship_full() const
 }
 
 
-int trading_menu::get_price(const cv::Mat& offering)
+cv::Mat trading_menu::get_price_image(const cv::Mat& offering) const
 {
 	cv::Mat price_img = recog.binarize(image_recognition::get_pane(trading_params::size_offering_price, offering), true, false);
-	unsigned int count_black = price_img.rows * price_img.cols - cv::countNonZero(price_img);
 
 	if (recog.is_verbose()) {
 		cv::imwrite("debug_images/price.png", price_img);
 	}
-	
-	auto iter = cached_prices.find(count_black);
-	int price = 0;
-
-	if(iter != cached_prices.end())
-	{
-		for(const auto& rendered_price : iter->second)
-		{
-			const auto& cached_img = rendered_price.second;
-			if (cached_img.rows != price_img.rows || cached_img.cols != price_img.cols)
-				continue;
 
-			cv::Mat diff;
-			
-			cv::bitwise_xor(price_img, cached_img, diff);
-
-			if(!cv::countNonZero(diff))
-			{
-				price = rendered_price.first;
-				//std::cout << "price cache hit: " << rendered_price.first << std::endl;
-				break;
-			}
-		}
-	}
-
-	if (!price)
-	{
-		cv::Mat price_img_rgb;
-		cv::cvtColor(price_img, price_img_rgb, cv::COLOR_GRAY2RGBA);
-		price = recog.number_from_region(price_img_rgb);
-
-		if(iter == cached_prices.end())
-		{
-			iter = cached_prices.emplace(count_black, std::vector<std::pair<int, cv::Mat>>()).first;
-		} 
-		iter->second.emplace_back(price, price_img);
-	}
+	// OCR accepts the single channel image
+	return price_img;
+}
 
-	return price;
+int trading_menu::get_price(const cv::Mat& offering)
+{
+	// number_from_region caches the result for prices that were rendered before
+	return recog.number_from_region(get_price_image(offering));
 }
 
 bool trading_menu::check_price(unsigned int guid, unsigned int selling_price, int price_modification_percent) const
 {
 	float multiplier = 1.f + price_modification_percent / 100.f;
-	float price = multiplier * recog.items[guid]->price;
+	float price = multiplier * recog.items.at(guid)->price;
 	return std::floor(price - 0.5f) <= selling_price && selling_price <= std::ceil(price + 0.5f);
 }
 
@@ -272,8 +286,7 @@ std::vector<offering> trading_menu::get_offerings(bool abort_if_not_loaded)
 	std::vector<offering> result;
 
 	cv::Rect2f offering_pane = get_window_rel_location(has_buy_limit() ? trading_params::pane_menu_offering_with_counter : trading_params::pane_menu_offering);
-	cv::Mat pane;
-	recog.get_pane(offering_pane, screenshot).copyTo(pane);
+	cv::Mat pane = recog.get_pane(offering_pane, screenshot);
 
 	cv::Point2f button_offset = get_reroll_button().tl() - offering_pane.tl();
 	cv::Rect2i button_reroll(static_cast<int>(button_offset.x * screenshot.cols),
@@ -289,7 +302,12 @@ std::vector<offering> trading_menu::get_offerings(bool abort_if_not_loaded)
 
 	cv::Rect2i offering_size = get_roi_abs_location(0);
 
-	std::vector<cv::Rect2i> boxes(recog.detect_boxes(pane, offering_size, button_reroll));
+	// contour detection only if the predicted grid does not pass the probes
+	std::vector<cv::Rect2i> boxes;
+	if (!predict_offering_boxes(pane, offering_pane, button_reroll, boxes))
+		boxes = recog.detect_boxes_normalized(pane, offering_size, button_reroll);
+	else
+		recog.check_box_parity(boxes, pane, offering_size, button_reroll);
 
 	std::sort(boxes.begin(), boxes.end(), [&offering_size](const cv::Rect2i& lhs, const cv::Rect2i& rhs) {
 		if (lhs.y + offering_size.height < rhs.y)
@@ -304,46 +322,67 @@ std::vector<offering> trading_menu::get_offerings(bool abort_if_not_loaded)
 	unsigned int index = 0;
 	int trade_price_modifier = get_price_modification();
 
+	// read all prices in one batch
+	std::vector<cv::Mat> price_images;
 	for (const cv::Rect2i& offering_loc : boxes)
-	{
-		int price = get_price(pane(offering_loc));
-		std::map<unsigned int, cv::Mat> icon_dictionary;
+		price_images.push_back(get_price_image(pane(offering_loc)));
+	std::vector<int> prices = recog.numbers_from_regions(price_images);
 
+	// recognize all offerings concurrently, evaluate the results in order
+	std::vector<std::vector<unsigned int>> candidates(boxes.size());
 
-		for (unsigned int guid : recog.trader_to_offerings.at(open_trader))
+	recog.parallel_for(boxes.size(), [&](std::size_t i)
 		{
-			if (recog.items.find(guid) == recog.items.end())
-				continue;
+			const cv::Rect2i& offering_loc = boxes[i];
+			int price = prices[i];
+			std::map<unsigned int, cv::Mat> icon_dictionary;
 
-			if (check_price(guid, price, trade_price_modifier))
-				icon_dictionary.emplace(guid, recog.items[guid]->icon);
-		}
 
-		std::vector<unsigned int> item_candidates;
+			for (unsigned int guid : recog.trader_to_offerings.at(open_trader))
+			{
+				if (recog.items.find(guid) == recog.items.end())
+					continue;
 
-		if (icon_dictionary.size() == 1)
-			item_candidates.push_back(icon_dictionary.begin()->first);
-		else
-		{
-			if (icon_dictionary.empty())
+				if (check_price(guid, price, trade_price_modifier))
+					icon_dictionary.emplace(guid, recog.items.at(guid)->icon);
+			}
+
+			std::vector<unsigned int> item_candidates;
+
+			if (icon_dictionary.size() == 1)
+				item_candidates.push_back(icon_dictionary.begin()->first);
+			else
 			{
-				for (unsigned int guid : recog.trader_to_offerings.at(open_trader))
+				if (icon_dictionary.empty())
 				{
-					if (recog.items.find(guid) == recog.items.end())
-						continue;
-					icon_dictionary.emplace(guid, recog.items[guid]->icon);
+					for (unsigned int guid : recog.trader_to_offerings.at(open_trader))
+					{
+						if (recog.items.find(guid) == recog.items.end())
+							continue;
+						icon_dictionary.emplace(guid, recog.items.at(guid)->icon);
+					}
 				}
+
+				for (const auto& entry : recog.item_backgrounds)
+					icon_dictionary.insert(entry);
+
+				cv::Mat icon = image_recognition::get_pane(trading_params::size_offering_icon, pane(offering_loc));
+				item_candidates = recog.get_guid_from_icon(
+					icon,
+					icon_dictionary,
+					trading_params::background_sand_bright,
+					recog.get_item_candidates(icon)
+				);
 			}
 
-			for (const auto& entry : recog.item_backgrounds)
-				icon_dictionary.insert(entry);
+			candidates[i] = std::move(item_candidates);
+		});
 
-			item_candidates = recog.get_guid_from_icon(
-				image_recognition::get_pane(trading_params::size_offering_icon, pane(offering_loc)),
-				icon_dictionary,
-				trading_params::background_sand_bright
-			);
-		}
+	for (std::size_t i = 0; i < boxes.size(); i++)
+	{
+		const cv::Rect2i& offering_loc = boxes[i];
+		int price = prices[i];
+		const std::vector<unsigned int>& item_candidates = candidates[i];
 
 		if (abort_if_not_loaded &&
 			(!item_candidates.size() ||
@@ -401,12 +440,36 @@ std::vector<offering> trading_menu::get_capped_items() const
 
 	cv::Rect2i icon_size(0, 0, static_cast<int>(trading_params::size_icon.width * screenshot.cols), static_cast<int>(trading_params::size_icon.height * screenshot.rows));
 	cv::Mat pane(recog.get_pane(trading_params::pane_menu_ship_sockets, screenshot));
-	std::vector<cv::Rect2i> boxes(recog.detect_boxes(pane, icon_size));
+	std::vector<cv::Rect2i> boxes;
+
+	// the sockets only change with the ship, reuse them while their borders are found
+	if (!socket_boxes.empty() && socket_pane_size == pane.size())
+	{
+		cv::Mat gray_pane = current_frame->get_gray(pane);
+		bool verified = true;
+		for (const cv::Rect2i& box : socket_boxes)
+			if (image_recognition::count_box_borders(gray_pane, box) < 4)
+			{
+				verified = false;
+				break;
+			}
 
-	if (boxes.size() <= 1)
+		if (verified && !has_unknown_socket(gray_pane))
+			boxes = socket_boxes;
+	}
+
+	if (boxes.empty())
 	{
-		cv::Rect2i icon_size_small(0, 0, static_cast<int>(trading_params::size_icon_small.width * screenshot.cols), static_cast<int>(trading_params::size_icon_small.height * screenshot.rows));
-		boxes = recog.detect_boxes(pane, icon_size_small);
+		boxes = recog.detect_boxes_normalized(pane, icon_size);
+
+		if (boxes.size() <= 1)
+		{
+			cv::Rect2i icon_size_small(0, 0, static_cast<int>(trading_params::size_icon_small.width * screenshot.cols), static_cast<int>(trading_params::size_icon_small.height * screenshot.rows));
+			boxes = recog.detect_boxes_normalized(pane, icon_size_small);
+		}
+
+		socket_boxes = boxes;
+		socket_pane_size = pane.size();
 
 		if (boxes.empty())
 			return result;
@@ -433,7 +496,8 @@ std::vector<offering> trading_menu::get_capped_items() const
 		std::vector<unsigned int> item_candidates = recog.get_guid_from_icon(
 			pane(item_loc),
 			ship_items,
-			trading_params::background_cargo_slot
+			trading_params::background_cargo_slot,
+			recog.get_item_candidates(pane(item_loc))
 		);
 
 		if (recog.is_verbose()) {
@@ -567,6 +631,81 @@ cv::Rect2i trading_menu::to_abs_location(const cv::Rect2f& box) const
 	return cv::Rect2i(box.x * width, box.y * height, box.width * width, box.height * height);
 }
 
+bool trading_menu::predict_offering_boxes(const cv::Mat& pane, const cv::Rect2f& offering_pane, const cv::Rect2i& ignore_region, std::vector<cv::Rect2i>& boxes) const
+{
+	boxes.clear();
+	cv::Mat gray_pane = current_frame->get_gray(pane);
+	cv::Rect2i pane_rect(0, 0, pane.cols, pane.rows);
+
+	for (unsigned int index = 0; index < trading_params::count_cols * trading_params::count_rows; index++)
+	{
+		cv::Rect2f location = get_window_rel_location(get_roi_rel_location(index));
+		cv::Rect2i box(static_cast<int>((location.x - offering_pane.x) * screenshot.cols),
+			static_cast<int>((location.y - offering_pane.y) * screenshot.rows),
+			static_cast<int>(location.width * screenshot.cols),
+			static_cast<int>(location.height * screenshot.rows));
+		box = box & pane_rect;
+
+		// detect_boxes removes all edges in the ignored region
+		if (box.empty() || (ignore_region & box).area())
+			continue;
+
+		// icons and price labels have edges close to the frame, only accept a box at the predicted location
+		int borders = image_recognition::count_box_borders(gray_pane, box, 1);
+		if (borders == 4)
+			boxes.push_back(box);
+		else if (borders > 1)
+			return false; // partially framed: misaligned grid or still rendering
+	}
+
+	return !boxes.empty();
+}
+
+bool trading_menu::has_unknown_socket(const cv::Mat& gray_pane) const
+{
+	const cv::Rect2i pane_rect(0, 0, gray_pane.cols, gray_pane.rows);
+
+	std::vector<bool> grouped(socket_boxes.size(), false);
+	for (std::size_t i = 0; i < socket_boxes.size(); i++)
+	{
+		if (grouped[i])
+			continue;
+
+		// boxes in the same row as socket_boxes[i], ordered from left to right
+		std::vector<cv::Rect2i> row;
+		for (std::size_t j = i; j < socket_boxes.size(); j++)
+			if (std::abs(socket_boxes[j].y - socket_boxes[i].y) < socket_boxes[i].height / 2)
+			{
+				grouped[j] = true;
+				row.push_back(socket_boxes[j]);
+			}
+
+		if (row.size() < 2)
+			return true;
+
+		std::sort(row.begin(), row.end(), [](const cv::Rect2i& lhs, const cv::Rect2i& rhs) { return lhs.x < rhs.x; });
+
+		int pitch = std::numeric_limits<int>::max();
+		for (std::size_t k = 1; k < row.size(); k++)
+			pitch = std::min(pitch, row[k].x - row[k - 1].x);
+		if (pitch < row.front().width)
+			return true;
+
+		for (cv::Rect2i probe = row.front(); probe.x >= 0; probe.x -= pitch)
+			if (probe.x < row.front().x && image_recognition::count_box_borders(gray_pane, probe) == 4)
+				return true;
+
+		for (cv::Rect2i probe = row.front(); (probe & pane_rect) == probe; probe.x += pitch)
+		{
+			bool known = std::any_of(row.begin(), row.end(), [&probe, pitch](const cv::Rect2i& box) { return std::abs(box.x - probe.x) < pitch / 2; });
+			if (!known && image_recognition::count_box_borders(gray_pane, probe) == 4)
+				return true;
+		}
+	}
+
+	return false;
+}
+
 cv::Rect2f trading_menu::get_roi_rel_location(unsigned int index) const
 {
 	if (!is_trading_menu_open())
@@ -8,6 +8,8 @@
 #include <opencv2/core/mat.hpp>
 #include <opencv2/core/types.hpp>
 
+#include "reader_frame.hpp"
+#include "reader_stability_gate.hpp"
 
 namespace reader
 {
@@ -72,6 +74,18 @@ public:
 	trading_menu(image_recognition& recog);
 
 	void update(const std::string& language, const cv::Mat& img);
+	/*
+	* Reads from @param{img} without copying it
+	*/
+	void update(const std::string& language, const frame::ptr& img);
+
+	/*
+	* Returns false while the trading menu opens or its items render in,
+	* i.e. while the offerings change between calls. Frames without the menu are always stable.
+	* Call with successive captures before update to skip intermediate frames,
+	* the title check is reused by a following update with the same @param{img}.
+	*/
+	bool is_stable(const std::string& language, const frame::ptr& img);
 
 
 	bool is_trading_menu_open() const;
@@ -133,17 +147,30 @@ public:
 
 private:
 	image_recognition& recog;
+	// screenshot is the cropped view of current_frame
+	frame::ptr current_frame;
 	cv::Mat screenshot;
 	std::map<unsigned int, cv::Mat> ship_items;
-	std::map<unsigned int, std::vector<std::pair<int, cv::Mat>>> cached_prices;
 	cv::Mat storage_icon;
 	unsigned int window_width;
 
 	unsigned int open_trader;
 	unsigned int buy_limit;
 	bool menu_open;
+	stability_gate gate;
+	// last frame whose title was checked and the result, see has_title
+	frame::ptr title_frame;
+	bool title_visible;
 	bool buy_limited;
+
+	// sockets found by the last contour detection, verified by probes on later frames
+	mutable std::vector<cv::Rect2i> socket_boxes;
+	mutable cv::Size socket_pane_size;
 	
+	/*
+	* Returns the binarized price region of @param{offering}
+	*/
+	cv::Mat get_price_image(const cv::Mat& offering) const;
 	int get_price(const cv::Mat& offering);
 	
 	/**
@@ -152,6 +179,27 @@ private:
 */
 	bool check_price(unsigned int guid, unsigned int selling_price, int price_modification_percent = 0) const;
 
+	/*
+	* Whether the title of the trading menu is visible in @param{img},
+	* checked once per frame
+	*/
+	bool has_title(const frame::ptr& img);
+
+	/*
+	* Predicts the offering boxes in @param{pane} from the grid and probes their borders
+	* with a tolerance of one pixel. Boxes intersecting @param{ignore_region} are skipped. Returns false if a box is
+	* neither framed nor absent, i.e. the grid does not match the screenshot.
+	*/
+	bool predict_offering_boxes(const cv::Mat& pane, const cv::Rect2f& offering_pane, const cv::Rect2i& ignore_region, std::vector<cv::Rect2i>& boxes) const;
+
+	/*
+	* Probes the positions in the rows of socket_boxes that continue their spacing
+	* to the borders of @param{gray_pane}. Returns true if one of them is framed,
+	* i.e. a socket rendered in after the last detection, or if a row has a single
+	* socket so that the spacing is unknown.
+	*/
+	bool has_unknown_socket(const cv::Mat& gray_pane) const;
+
 	cv::Rect2i get_roi_abs_location(unsigned int index) const;
 	cv::Rect2f get_roi_rel_location(unsigned int index) const;
 
@@ -24,20 +24,14 @@
 #include <opencv2/imgproc.hpp>
 
 #include <tesseract/genericvector.h>
+#include "reader_binarization.hpp"
+#include "reader_line_detection.hpp"
 #include "reader_statistics_screen.hpp"
 
 
 namespace reader
 {
 
-struct comparePoints {
-	bool operator()(const cv::Point& a, const cv::Point& b) const {
-		if (a.x != b.x)
-			return a.x < b.x;
-		return a.y < b.y;
-	}
-};
-
 
 
 ////////////////////////////////////////
@@ -51,7 +45,6 @@ image_recognition::image_recognition(bool verbose, std::string window_regex)
 	:
 	window_regex(window_regex.empty() ? "(Anno 1800)|(Anno 7)|(Anno 1800.* GeForce NOW)" : std::move(window_regex)),
 	verbose(verbose),
-	ocr(nullptr),
 	ocr_language("english")/*,
 	number_mode(false)*/
 {
@@ -116,6 +109,8 @@ image_recognition::image_recognition(bool verbose, std::string window_regex)
 	session_to_region.emplace(110934, 5000000);
 	session_icons.emplace(112132, binarize_icon(load_image("icons/icon_session_landoflions_white.png")));
 	session_to_region.emplace(112132, 114327);
+	for (const auto& entry : session_icons)
+		session_silhouettes.emplace(entry.first, pack_silhouette(entry.second));
 
 	// load products
 	for (const auto& product : pt.get_child("products"))
@@ -271,6 +266,13 @@ image_recognition::image_recognition(bool verbose, std::string window_regex)
 	}
 
 	initialize_items();
+
+	for (const auto& entry : dictionaries)
+	{
+		const keyword_dictionary& dict = entry.second;
+		for (const auto* dictionary : { &dict.population_levels, &dict.factories, &dict.items, &dict.products, &dict.ui_texts, &dict.traders })
+			text_matchers.emplace(dictionary, text_matcher(*dictionary));
+	}
 }
 
 std::string image_recognition::to_string(const std::wstring& str)
@@ -312,10 +314,26 @@ cv::Mat image_recognition::get_pane(const cv::Rect2f& rect, const cv::Mat& img)
 	if (!img.size)
 		return img;
 
-	cv::Point2f factor(img.cols - 1, img.rows - 1);
-	cv::Rect scaled(cv::Point(static_cast<int>(rect.tl().x * factor.x), static_cast<int>(rect.tl().y * factor.y)),
+	return img(get_pane_location(rect, img.size()));
+}
+
+cv::Rect image_recognition::get_pane_location(const cv::Rect2f& rect, const cv::Size& size)
+{
+	cv::Point2f factor(size.width - 1, size.height - 1);
+	return cv::Rect(cv::Point(static_cast<int>(rect.tl().x * factor.x), static_cast<int>(rect.tl().y * factor.y)),
 		cv::Point(static_cast<int>(rect.br().x * factor.x), static_cast<int>(rect.br().y * factor.y)));
-	return img(scaled);
+}
+
+cv::Mat image_recognition::get_corresponding_region(const cv::Mat& region, const cv::Mat& source, const cv::Mat& target)
+{
+	if (region.empty())
+		return cv::Mat();
+
+	// locate the view by its offset in the buffer of source
+	std::ptrdiff_t offset = region.data - source.data;
+	int y = static_cast<int>(offset / static_cast<std::ptrdiff_t>(source.step));
+	int x = static_cast<int>(offset % static_cast<std::ptrdiff_t>(source.step) / static_cast<std::ptrdiff_t>(source.elemSize()));
+	return target(cv::Rect(x, y, region.cols, region.rows));
 }
 
 bool image_recognition::closer_to(const cv::Scalar& color, const cv::Scalar& ref, const cv::Scalar& other)
@@ -341,53 +359,95 @@ bool image_recognition::is_button(const cv::Mat& image, const cv::Scalar& button
 
 std::list<cv::Point> image_recognition::find_rgb_region(const cv::Mat& in, const cv::Point& seed, float threshold)
 {
-	cv::Mat input = in;
 	std::list<cv::Point> ret;
+	fill_rgb_region(in, seed, threshold, [&ret](int y, int x_begin, int x_end)
+		{
+			for (int x = x_begin; x < x_end; x++)
+				ret.emplace_back(x, y);
+		});
+	return ret;
+}
 
-	if (seed.x >= input.cols || seed.y >= input.rows)
-		return ret;
-
-	const cv::Rect img_rect = cv::Rect({ 0,0 }, in.size());
-
-	std::set < cv::Point, comparePoints> open;
-	open.insert(seed);
-	const auto seed_color = input.at<cv::Vec4b>(seed);
-
-	std::set<cv::Point, comparePoints> closed;
+std::pair<cv::Rect, std::size_t> image_recognition::find_rgb_region_bounds(const cv::Mat& in, const cv::Point& seed, float threshold)
+{
+	cv::Point min(in.cols, in.rows);
+	cv::Point max(0, 0);
+	std::size_t count = 0;
 
+	fill_rgb_region(in, seed, threshold, [&](int y, int x_begin, int x_end)
+		{
+			min.x = std::min(min.x, x_begin);
+			min.y = std::min(min.y, y);
+			max.x = std::max(max.x, x_end);
+			max.y = std::max(max.y, y + 1);
+			count += x_end - x_begin;
+		});
 
+	if (!count)
+		return std::make_pair(cv::Rect(cv::Point(0, 0), cv::Point(0, 0)), count);
 
-	while (!open.empty()) {
-		const cv::Point current_point = *open.begin();
-		open.erase(open.begin());
+	return std::make_pair(cv::Rect(min, max), count);
+}
 
+void image_recognition::fill_rgb_region(const cv::Mat& input, const cv::Point& seed, float threshold,
+	const std::function<void(int y, int x_begin, int x_end)>& span)
+{
+	if (seed.x < 0 || seed.y < 0 || seed.x >= input.cols || seed.y >= input.rows)
+		return;
 
-		const auto cc = input.at<cv::Vec4b>(current_point);
+	const cv::Vec4b seed_color = input.at<cv::Vec4b>(seed);
+	auto matches = [&](const cv::Vec4b& cc)
+	{
 		const int color_diff = (cc.val[0] - int(seed_color.val[0])) * (cc.val[0] - int(seed_color.val[0]))
 			+ (cc.val[1] - int(seed_color.val[1])) * (cc.val[1] - int(seed_color.val[1]))
 			+ (cc.val[2] - int(seed_color.val[2])) * (cc.val[2] - int(seed_color.val[2]))
 			+ (cc.val[3] - int(seed_color.val[3])) * (cc.val[3] - int(seed_color.val[3]));
-		if (color_diff
-			<= threshold)
+		return color_diff <= threshold;
+	};
+
+	// one byte per pixel, set once a pixel was added to the region
+	std::vector<unsigned char> visited(static_cast<std::size_t>(input.rows) * input.cols, 0);
+	std::vector<cv::Point> open({ seed });
+
+	while (!open.empty())
+	{
+		const cv::Point current_point = open.back();
+		open.pop_back();
+
+		const cv::Vec4b* row = input.ptr<cv::Vec4b>(current_point.y);
+		unsigned char* visited_row = visited.data() + static_cast<std::size_t>(current_point.y) * input.cols;
+		if (visited_row[current_point.x] || !matches(row[current_point.x]))
+			continue;
+
+		// extend the span to both sides
+		int x_begin = current_point.x;
+		while (x_begin > 0 && !visited_row[x_begin - 1] && matches(row[x_begin - 1]))
+			x_begin--;
+		int x_end = current_point.x + 1;
+		while (x_end < input.cols && !visited_row[x_end] && matches(row[x_end]))
+			x_end++;
+
+		std::fill(visited_row + x_begin, visited_row + x_end, 1);
+		span(current_point.y, x_begin, x_end);
+
+		// seed one point per run of matching pixels in the adjacent rows
+		for (int y : { current_point.y - 1, current_point.y + 1 })
 		{
-			ret.push_back(current_point);
-			cv::Point new_candidates[4] = {
-				current_point + cv::Point(1,0),
-				current_point + cv::Point(0,1),
-				current_point + cv::Point(-1,0),
-				current_point + cv::Point(0,-1)
-			};
-			for (int i = 0; i < 4; i++) {
-				if (new_candidates[i].inside(img_rect)
-					&& closed.find(new_candidates[i]) == closed.end())
-				{
-					open.insert(new_candidates[i]);
-				}
+			if (y < 0 || y >= input.rows)
+				continue;
+
+			const cv::Vec4b* adjacent_row = input.ptr<cv::Vec4b>(y);
+			const unsigned char* adjacent_visited = visited.data() + static_cast<std::size_t>(y) * input.cols;
+			bool in_run = false;
+			for (int x = x_begin; x < x_end; x++)
+			{
+				bool candidate = !adjacent_visited[x] && matches(adjacent_row[x]);
+				if (candidate && !in_run)
+					open.emplace_back(x, y);
+				in_run = candidate;
 			}
 		}
-		closed.insert(current_point);
 	}
-	return ret;
 }
 
 cv::Mat image_recognition::blend_icon(const cv::Mat& icon, const cv::Scalar& background_color)
@@ -446,7 +506,8 @@ std::pair<cv::Rect, float> image_recognition::find_icon(const cv::Mat& source, c
 
 std::vector<unsigned int> image_recognition::get_guid_from_icon(const cv::Mat& icon,
 	const std::map<unsigned int, cv::Mat>& dictionary,
-	const cv::Mat& background) const
+	const cv::Mat& background,
+	const std::vector<unsigned int>& preferred) const
 {
 	if (icon.empty())
 		return std::vector<unsigned int>();
@@ -459,32 +520,91 @@ std::vector<unsigned int> image_recognition::get_guid_from_icon(const cv::Mat& i
 	float best_match = static_cast<float>(cv::sum(diff).ddot(cv::Scalar::ones()) / icon.rows / icon.cols);
 	std::vector<unsigned int> guids;
 
+	const std::uint64_t background_hash = hash_image(background_resized);
+	std::shared_ptr<icon_atlas> atlas;
+	std::uint64_t generation = 0;
+
+	std::vector<std::size_t> slots;
+	std::vector<unsigned int> slot_guids;
+	slots.reserve(dictionary.size());
+	slot_guids.reserve(dictionary.size());
+
+	// slots identify the templates (and the background) as long as the atlas exists
+	std::uint64_t key = combine_hash(combine_hash(hash_image(icon), icon.type()), background_hash);
 
-	for (auto& entry : dictionary)
 	{
-		cv::Mat template_resized;
-		cv::resize(blend_icon(entry.second, background_resized), template_resized, cv::Size(icon.cols, icon.rows));
+		std::lock_guard<std::shared_mutex> lock(icon_mutex);
+		atlas = get_icon_atlas(icon.size(), icon.type(), background_hash);
+		generation = icon_generation;
 
-		cv::Mat diff;
-		cv::absdiff(icon, template_resized, diff);
-		float match = cv::sum(diff).ddot(cv::Scalar::ones()) / icon.rows / icon.cols;
-		if (match == best_match)
+		for (auto& entry : dictionary)
+		{
+			slots.push_back(get_icon_slot(*atlas, entry.second, background_resized));
+			slot_guids.push_back(entry.first);
+			key = combine_hash(combine_hash(key, entry.first), slots.back());
+		}
+
+		if (const auto* cached = icon_cache.find(key))
 		{
+			if (verbose && !cached->empty()) {
+				for (unsigned int guid : *cached)
+					std::cout << guid << ", ";
+				std::cout << "(cached)\t";
+			}
+			return *cached;
+		}
+	}
+
+	std::vector<std::size_t> priority;
+	for (unsigned int guid : preferred)
+	{
+		auto iter = std::lower_bound(slot_guids.begin(), slot_guids.end(), guid);
+		if (iter != slot_guids.end() && *iter == guid)
+			priority.push_back(iter - slot_guids.begin());
+	}
+
+	bool check_parity = false;
+	std::vector<unsigned int> reference_guids;
+	float reference_match = best_match;
+
+	{
+		// other threads score concurrently, adding templates moves the buffer of the atlas
+		std::shared_lock<std::shared_mutex> lock(icon_mutex);
+		for (std::size_t index : atlas->find_nearest(icon, slots, best_match, priority))
+			guids.push_back(slot_guids[index]);
+
+		check_parity = parity_checks;
+		if (check_parity)
+			for (std::size_t index : atlas->find_nearest_exhaustive(icon, slots, reference_match))
+				reference_guids.push_back(slot_guids[index]);
+
 #ifdef SHOW_CV_DEBUG_IMAGE_VIEW
-			cv::imwrite("debug_images/icon_template.png", template_resized);
+		if (!guids.empty())
+			cv::imwrite("debug_images/icon_template.png", atlas->get_template(slots[std::find(slot_guids.begin(), slot_guids.end(), guids.front()) - slot_guids.begin()]));
 #endif
-			guids.push_back(entry.first);
 	}
-		else if (match < best_match)
+
+	if (best_match > 150)
+		guids.clear();
+	if (reference_match > 150)
+		reference_guids.clear();
+
+	{
+		std::lock_guard<std::shared_mutex> lock(icon_mutex);
+		// the slots in the key may be reused by new atlases
+		if (generation == icon_generation)
+			icon_cache.insert(key, guids);
+
+		if (check_parity)
 		{
-			guids.clear();
-			guids.push_back(entry.first);
-			best_match = match;
+			icon_parity.checks++;
+			if (guids != reference_guids || best_match != reference_match)
+				icon_parity.mismatches++;
 		}
-}
+	}
 
-	if (best_match > 150)
-		return std::vector<unsigned int>();
+	if (guids.empty())
+		return guids;
 
 	if (verbose) {
 		for (unsigned int guid : guids)
@@ -495,6 +615,164 @@ std::vector<unsigned int> image_recognition::get_guid_from_icon(const cv::Mat& i
 }
 
 
+std::shared_ptr<icon_atlas> image_recognition::get_icon_atlas(const cv::Size& size, int type, std::uint64_t background_hash) const
+{
+	std::size_t template_count = 0;
+	for (const auto& entry : icon_atlases)
+		template_count += entry.second->size();
+
+	if (template_count >= MAX_ICON_TEMPLATES)
+	{
+		icon_atlases.clear();
+		icon_cache.clear();
+		icon_generation++;
+	}
+
+	icon_atlas_key key{ size, type, background_hash };
+	auto iter = icon_atlases.find(key);
+	if (iter == icon_atlases.end())
+		iter = icon_atlases.emplace(key, std::make_shared<icon_atlas>(size, type)).first;
+
+	return iter->second;
+}
+
+std::size_t image_recognition::get_icon_slot(icon_atlas& atlas, const cv::Mat& icon, const cv::Mat& background) const
+{
+	std::size_t slot = atlas.find(icon);
+	if (slot != icon_atlas::npos)
+		return slot;
+
+	cv::Mat template_resized;
+	cv::resize(blend_icon(icon, background), template_resized, atlas.get_template_size());
+	return atlas.add(icon, template_resized);
+}
+
+void image_recognition::clear_icon_templates()
+{
+	std::lock_guard<std::shared_mutex> lock(icon_mutex);
+	icon_atlases.clear();
+	icon_cache.clear();
+	icon_generation++;
+}
+
+std::uint64_t image_recognition::hash_image(const cv::Mat& img)
+{
+	// FNV-1a over all rows, works on non-continuous ROIs
+	std::uint64_t hash = 14695981039346656037ull;
+	const std::size_t row_bytes = img.cols * img.elemSize();
+
+	for (int y = 0; y < img.rows; y++)
+	{
+		const unsigned char* row = img.ptr<unsigned char>(y);
+		for (std::size_t x = 0; x < row_bytes; x++)
+		{
+			hash ^= row[x];
+			hash *= 1099511628211ull;
+		}
+	}
+
+	hash ^= static_cast<std::uint64_t>(img.cols) << 32 ^ img.rows;
+	hash *= 1099511628211ull;
+
+	return hash;
+}
+
+std::uint64_t image_recognition::combine_hash(std::uint64_t seed, std::uint64_t value)
+{
+	return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 12) + (seed >> 4));
+}
+
+std::map<std::string, cache_statistics> image_recognition::get_cache_statistics() const
+{
+	std::lock_guard<std::shared_mutex> icon_lock(icon_mutex);
+	std::lock_guard<std::mutex> cache_lock(cache_mutex);
+	return {
+		{ "words", word_cache.get_statistics() },
+		{ "numbers", number_cache.get_statistics() },
+		{ "icons", icon_cache.get_statistics() },
+		{ "digits", digits.get_statistics() },
+		{ "row_grids", row_grids.get_statistics() },
+		{ "screens", screens.get_statistics() }
+	};
+}
+
+void image_recognition::enable_parity_checks(bool enable)
+{
+	std::lock_guard<std::shared_mutex> icon_lock(icon_mutex);
+	std::lock_guard<std::mutex> cache_lock(cache_mutex);
+	parity_checks = enable;
+	cell_parity = parity_statistics();
+	icon_parity = parity_statistics();
+	box_parity = parity_statistics();
+}
+
+std::map<std::string, parity_statistics> image_recognition::get_parity_statistics() const
+{
+	std::lock_guard<std::shared_mutex> icon_lock(icon_mutex);
+	std::lock_guard<std::mutex> cache_lock(cache_mutex);
+	return {
+		{ "boxes", box_parity },
+		{ "cells", cell_parity },
+		{ "icons", icon_parity }
+	};
+}
+
+void image_recognition::check_box_parity(const std::vector<cv::Rect2i>& predicted, const cv::Mat& im, const cv::Rect2i& box, const cv::Rect2i& ignore_region) const
+{
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		if (!parity_checks)
+			return;
+	}
+
+	std::vector<cv::Rect2i> detected = detect_boxes_normalized(im, box, ignore_region);
+	for (const cv::Rect2i& bb : predicted)
+	{
+		bool match = std::any_of(detected.begin(), detected.end(), [&bb](const cv::Rect2i& reference)
+			{
+				return std::abs(bb.x - reference.x) <= 1 && std::abs(bb.y - reference.y) <= 1 &&
+					std::abs(bb.br().x - reference.br().x) <= 1 && std::abs(bb.br().y - reference.br().y) <= 1;
+			});
+
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		box_parity.checks++;
+		if (!match)
+		{
+			box_parity.mismatches++;
+			if (verbose)
+				std::cout << "predicted box at (" << bb.x << ", " << bb.y << ") differs from the detected boxes" << std::endl;
+		}
+	}
+}
+
+void image_recognition::clear_result_caches()
+{
+	std::lock_guard<std::shared_mutex> icon_lock(icon_mutex);
+	std::lock_guard<std::mutex> cache_lock(cache_mutex);
+	word_cache.clear();
+	number_cache.clear();
+	icon_cache.clear();
+	row_grids.clear();
+	screens.clear();
+}
+
+void image_recognition::clear_row_grids()
+{
+	row_grids.clear();
+}
+
+bool image_recognition::icon_atlas_key::operator<(const icon_atlas_key& other) const
+{
+	if (size.width != other.size.width)
+		return size.width < other.size.width;
+	if (size.height != other.size.height)
+		return size.height < other.size.height;
+	if (type != other.type)
+		return type < other.type;
+	return background_hash < other.background_hash;
+}
+
+
 std::vector<unsigned int> image_recognition::get_guid_from_hu_moments(const cv::Mat& icon,
 	const std::map<unsigned int, std::vector<double>>& dictionary) const
 {
@@ -532,13 +810,22 @@ std::vector<unsigned int> image_recognition::get_guid_from_hu_moments(const cv::
 }
 
 
-std::vector<unsigned int> image_recognition::get_guid_from_icon(const cv::Mat& icon, const std::map<unsigned int, cv::Mat>& dictionary, const cv::Scalar& background_color) const
+std::vector<unsigned int> image_recognition::get_guid_from_icon(const cv::Mat& icon, const std::map<unsigned int, cv::Mat>& dictionary, const cv::Scalar& background_color,
+	const std::vector<unsigned int>& preferred) const
 {
 	if (icon.empty())
 		return std::vector<unsigned int>();
 
 	return get_guid_from_icon(icon, dictionary,
-		cv::Mat(icon.rows, icon.cols, CV_8UC4, background_color));
+		cv::Mat(icon.rows, icon.cols, CV_8UC4, background_color), preferred);
+}
+
+std::vector<unsigned int> image_recognition::get_item_candidates(const cv::Mat& icon, unsigned int max_distance) const
+{
+	if (icon.empty())
+		return std::vector<unsigned int>();
+
+	return item_hashes.find(icon_hash_index::compute_hash(icon), max_distance);
 }
 
 unsigned int image_recognition::get_session_guid(cv::Mat icon) const
@@ -546,22 +833,38 @@ unsigned int image_recognition::get_session_guid(cv::Mat icon) const
 	if (icon.empty())
 		return 0;
 
+	// the silhouette of the input does not depend on the compared icon, extract it once
+	cv::Mat icon_processed = binarize_icon(icon);
+	if (icon_processed.empty())
+		return 0;
+
+#ifdef SHOW_CV_DEBUG_IMAGE_VIEW
+	cv::imwrite("debug_images/icon_intersect.png", icon_processed);
+#endif
+
+	const std::vector<std::uint64_t> icon_mask = pack_silhouette(icon_processed);
+	int icon_white_count = 0;
+	for (std::uint64_t word : icon_mask)
+		icon_white_count += icon_hash_index::popcount(word);
+
 	float best_match = 0;
 	unsigned int guid = 0;
 
-	for (auto& entry : session_icons)
+	for (auto& entry : session_silhouettes)
 	{
+		int session_white_count = 0;
+		int intersection = 0;
+		for (std::size_t i = 0; i < icon_mask.size(); i++)
+		{
+			session_white_count += icon_hash_index::popcount(entry.second[i]);
+			intersection += icon_hash_index::popcount(entry.second[i] & icon_mask[i]);
+		}
 
-		cv::Mat icon_processed = binarize_icon(icon, entry.second.size());
-		int icon_white_count = cv::countNonZero(icon_processed);
-		cv::bitwise_and(entry.second, icon_processed, icon_processed);
-
-#ifdef SHOW_CV_DEBUG_IMAGE_VIEW
-		cv::imwrite("debug_images/icon_intersect.png", icon_processed);
-#endif
+		float max_intersection = std::max(icon_white_count, session_white_count);
+		if (!max_intersection)
+			continue;
 
-		float max_intersection = std::max(icon_white_count, cv::countNonZero(entry.second));
-		float match = cv::countNonZero(icon_processed) / max_intersection;
+		float match = intersection / max_intersection;
 
 #ifdef CONSOLE_DEBUG_OUTPUT
 		std::cout << "\t(" << entry.first << ", " << match << ")";
@@ -581,8 +884,33 @@ unsigned int image_recognition::get_session_guid(cv::Mat icon) const
 		return 0;
 
 	return guid;
+}
+
+std::vector<std::uint64_t> image_recognition::pack_silhouette(const cv::Mat& silhouette)
+{
+	std::vector<std::uint64_t> mask(SILHOUETTE_SIZE * SILHOUETTE_SIZE / 64, 0);
+	if (silhouette.empty())
+		return mask;
+
+	cv::Mat scaled;
+	cv::resize(silhouette, scaled, cv::Size(SILHOUETTE_SIZE, SILHOUETTE_SIZE), 0, 0, cv::INTER_NEAREST);
+	if (scaled.channels() > 1)
+		cv::cvtColor(scaled, scaled, cv::COLOR_BGRA2GRAY);
+
+	for (int y = 0; y < SILHOUETTE_SIZE; y++)
+	{
+		const unsigned char* row = scaled.ptr<unsigned char>(y);
+		for (int x = 0; x < SILHOUETTE_SIZE; x++)
+			if (row[x])
+			{
+				int bit = y * SILHOUETTE_SIZE + x;
+				mask[bit / 64] |= std::uint64_t(1) << (bit % 64);
+			}
 	}
 
+	return mask;
+}
+
 
 
 std::vector<unsigned int> image_recognition::get_guid_from_name(const cv::Mat& text_img,
@@ -616,36 +944,39 @@ std::vector<unsigned int> image_recognition::get_guid_from_name(const cv::Mat& t
 	return get_guid_from_name(building_string, dictionary);
 	}
 
-std::vector<unsigned int> image_recognition::get_guid_from_name(const std::string& building_string, const std::map<unsigned int, std::string>& dictionary)
+std::vector<unsigned int> image_recognition::get_guid_from_name(const std::string& building_string, const std::map<unsigned int, std::string>& dictionary) const
 {
-	std::vector<unsigned int> guids;
-	float best_match = 0.f;
-	for (const auto& entry : dictionary)
-	{
-		std::vector<std::string> split_string;
-		boost::split(split_string, entry.second, [](char c) {return c == ' '; });
-		std::string kw = boost::join(split_string, "");
+	auto iter = text_matchers.find(&dictionary);
+	if (iter != text_matchers.end())
+		return iter->second.find(building_string);
 
-		float total_length = std::max(kw.size(), building_string.size());
-		int min_lcs_length = total_length - static_cast<int>(std::roundf(-0.677f + 1.51 * std::logf(total_length)));
-		int lcs_length = image_recognition::lcs_length(kw, building_string);
-		float match = lcs_length / total_length;
+	// custom dictionary, e.g. from make_dictionary
+	return text_matcher(dictionary).find(building_string);
+}
 
-		if (lcs_length >= min_lcs_length)
-		{
-			if (match == best_match)
-			{
-				guids.push_back(entry.first);
-			}
-			else if (match > best_match)
-			{
-				guids.clear();
-				guids.push_back(entry.first);
-				best_match = match;
-			}
-		}
+bool image_recognition::has_title(const cv::Mat& pane, phrase title)
+{
+	const std::string language = get_ocr_language();
+	switch (screens.classify(language, static_cast<unsigned int>(title), pane))
+	{
+	case screen_classifier::verdict::PRESENT:
+		return true;
+	case screen_classifier::verdict::ABSENT:
+		return false;
+	default:
+		break;
 	}
-	return guids;
+
+	cv::Mat text = binarize(pane, true);
+	if (is_verbose()) {
+		cv::imwrite("debug_images/title.png", text);
+	}
+
+	if (get_guid_from_name(text, make_dictionary({ title })).empty())
+		return false;
+
+	screens.learn(language, static_cast<unsigned int>(title), pane);
+	return true;
 }
 
 
@@ -842,6 +1173,8 @@ void image_recognition::initialize_items()
 		unsigned int rarity = item.second.get_child("rarity").get_value<unsigned int>();
 
 		cv::Mat icon(create_icon(path, rarity));
+		if (!icon.empty())
+			item_hashes.insert(icon_hash_index::compute_hash(icon), guid);
 
 		std::set<unsigned int> traders;
 		for (const auto& trader : item.second.get_child("traders"))
@@ -907,30 +1240,34 @@ cv::Mat image_recognition::binarize(const cv::Mat& input, bool invert, bool mult
 	if (input.empty())
 		return input;
 
+	// convert first, scaling a single channel is cheaper
 	cv::Mat resized, thresholded;
 	if (input.rows < 40)
 	{
 		float scale = 45.f / input.rows;
-		cv::resize(input, resized, cv::Size(), scale, scale, cv::INTER_CUBIC);
+		cv::resize(to_gray(input), resized, cv::Size(), scale, scale, cv::INTER_CUBIC);
 	}
 	else
 		resized = input;
 
-	int flag = invert ? cv::THRESH_BINARY_INV : cv::THRESH_BINARY;
-	if (threshold < 0)
-	{
-		threshold = 128;
-		flag = flag | cv::THRESH_OTSU;
-	}
-
-	cv::cvtColor(resized, thresholded, cv::COLOR_BGRA2GRAY);
-	cv::threshold(thresholded, thresholded, threshold, 255, flag);
+	// conversion, histogram and threshold in one pass
+	binarization::binarize(resized, thresholded, invert, threshold);
 	if (multi_channel)
 		cv::cvtColor(thresholded, thresholded, cv::COLOR_GRAY2RGBA);
 
 	return thresholded;
 }
 
+cv::Mat image_recognition::to_gray(const cv::Mat& input)
+{
+	if (input.empty() || input.channels() == 1)
+		return input;
+
+	cv::Mat gray;
+	binarization::to_gray(input, gray);
+	return gray;
+}
+
 
 
 cv::Mat image_recognition::binarize_icon(const cv::Mat& input, cv::Size target_size)
@@ -940,8 +1277,7 @@ cv::Mat image_recognition::binarize_icon(const cv::Mat& input, cv::Size target_s
 
 	cv::Mat thresholded;
 	cv::Mat input_alpha_applied = blend_icon(input, cv::Scalar(0, 0, 0));
-	cv::cvtColor(input_alpha_applied, thresholded, cv::COLOR_BGRA2GRAY);
-	cv::threshold(thresholded, thresholded, 128, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+	binarization::binarize(input_alpha_applied, thresholded);
 	if (thresholded.at<unsigned char>(thresholded.rows - 1, thresholded.cols - 1) > 128)
 		thresholded = 255 - thresholded;
 
@@ -985,18 +1321,8 @@ cv::Mat image_recognition::binarize_icon(const cv::Mat& input, cv::Size target_s
 
 cv::Mat image_recognition::convert_color_space_for_template_matching(const cv::Mat& bgr_in)
 {
-	std::vector<cv::Mat> channels;
-	cv::split(bgr_in, channels);
-	for (auto& c : channels)
-	{
-		double min, max;
-		cv::minMaxLoc(c, &min, &max);
-		cv::threshold(c, c, 0.5f * (min + max), 255.f, cv::THRESH_BINARY);
-	}
-	cv::Mat ret;
-	cv::merge(channels.data(), 3, ret);
-
-	return ret;
+	// thresholds each channel between its min and max without splitting
+	return binarization::binarize_channels(bgr_in);
 }
 
 cv::Mat image_recognition::gamma_invariant_hue_finlayson(const cv::Mat& bgr_in)
@@ -1089,12 +1415,20 @@ cv::Rect image_recognition::get_aa_bb(const std::list<cv::Point>& input)
 	return cv::Rect(min, max + cv::Point(1, 1));
 }
 
-void image_recognition::update(const std::string& language)
+void image_recognition::update(const std::string& language, const cv::Size& resolution)
 {
 	auto my_language = has_language(language) ? language : "english";
 
 	update_ocr(my_language/*, number_mode*/);
 
+	if (resolution.area() && resolution != this->resolution)
+	{
+		if (verbose) {
+			std::cout << "Resolution changed to " << resolution.width << "x" << resolution.height << ", clear icon templates" << std::endl;
+		}
+		clear_icon_templates();
+		this->resolution = resolution;
+	}
 
 }
 
@@ -1257,85 +1591,320 @@ std::vector<std::pair<std::string, cv::Rect>> image_recognition::detect_words(co
 	cv::Mat input = in;
 	std::vector<std::pair<std::string, cv::Rect>> ret;
 
-	update_ocr(ocr_language/*, numbers_only*/);
+	std::uint64_t key = get_word_key(input, mode, numbers_only);
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		if (const auto* cached = word_cache.find(key))
+			return *cached;
+	}
 
 	try {
-		const auto& cr = ocr;
+		std::shared_ptr<tesseract::TessBaseAPI> cr = acquire_ocr();
 		cr->SetPageSegMode(mode);
 
 		// Set image data
-		cr->SetImage(input.data, input.cols, input.rows, 4, input.step);
+		cr->SetImage(input.data, input.cols, input.rows, static_cast<int>(input.elemSize()), static_cast<int>(input.step));
 
 		cr->Recognize(0);
-		tesseract::ResultIterator* ri = cr->GetIterator();
-		tesseract::PageIteratorLevel level = tesseract::RIL_WORD;
-
-
-
-		if (ri != 0) {
-			ret.reserve(10);
-			do {
-				const char* word = ri->GetUTF8Text(level);
+		ret = get_words(*cr);
 
-				int x1, y1, x2, y2;
-				ri->BoundingBox(level, &x1, &y1, &x2, &y2);
-				//if(verbose){
-				//				printf("word: '%s';\t\tconf: %.2f; BoundingBox: %d,%d,%d,%d;\n",
-				//					word, conf, x1, y1, x2, y2);
-				//}
-				std::string word_s = word ? std::string(word) : std::string();
-				cv::Rect aa_bb(cv::Point(x1, y1), cv::Point(x2, y2));
-				ret.push_back(std::make_pair(word_s, aa_bb));
-				delete[] word;
-			} while (ri->Next(level));
-		}
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		word_cache.insert(key, ret);
 	}
 	catch (...) {}
 
 	return ret;
 }
 
-
-
-bool image_recognition::has_language(const std::string& language) const
+std::vector<std::pair<std::string, cv::Rect>> image_recognition::get_words(tesseract::TessBaseAPI& ocr, const cv::Point& origin)
 {
-	return dictionaries.find(language) != dictionaries.end() && tesseract_languages.find(language) != tesseract_languages.end();
-}
+	std::vector<std::pair<std::string, cv::Rect>> ret;
+	tesseract::ResultIterator* ri = ocr.GetIterator();
+	tesseract::PageIteratorLevel level = tesseract::RIL_WORD;
+
+	if (ri != 0) {
+		ret.reserve(10);
+		do {
+			const char* word = ri->GetUTF8Text(level);
+
+			int x1, y1, x2, y2;
+			ri->BoundingBox(level, &x1, &y1, &x2, &y2);
+			//if(verbose){
+			//				printf("word: '%s';\t\tconf: %.2f; BoundingBox: %d,%d,%d,%d;\n",
+			//					word, conf, x1, y1, x2, y2);
+			//}
+			std::string word_s = word ? std::string(word) : std::string();
+			cv::Rect aa_bb(cv::Point(x1, y1) - origin, cv::Point(x2, y2) - origin);
+			ret.push_back(std::make_pair(word_s, aa_bb));
+			delete[] word;
+		} while (ri->Next(level));
 
-bool image_recognition::is_verbose() const
-{
-	return verbose;
+		delete ri;
+	}
+
+	return ret;
 }
 
-const keyword_dictionary& image_recognition::get_dictionary() const
+std::uint64_t image_recognition::get_word_key(const cv::Mat& im, tesseract::PageSegMode mode, bool numbers_only, bool cell) const
 {
-	auto iter = dictionaries.find(ocr_language);
-	if (iter == dictionaries.end())
-		throw std::exception("language not found");
-	return iter->second;
+	return combine_hash(combine_hash(hash_image(im), im.type()),
+		combine_hash(static_cast<std::uint64_t>(mode) << 2 | cell << 1 | numbers_only, std::hash<std::string>()(get_ocr_language())));
 }
 
-std::map<unsigned int, std::string>  image_recognition::make_dictionary(const std::vector<phrase>& list) const
+std::vector<std::vector<std::pair<std::string, cv::Rect>>> image_recognition::detect_words_in_cells(const cv::Mat& page,
+	const std::vector<cv::Rect>& cells,
+	tesseract::PageSegMode mode,
+	bool numbers_only)
 {
-	std::map<unsigned int, std::string> result;
-	const std::map<unsigned int, std::string>& source = get_dictionary().ui_texts;
+	std::vector<std::vector<std::pair<std::string, cv::Rect>>> result(cells.size());
+	const cv::Rect page_rect(0, 0, page.cols, page.rows);
 
-	for (phrase w : list)
+	// Tesseract may segment a cell of a page differently than the cropped image
+	std::vector<std::uint64_t> keys(cells.size());
+	std::vector<std::size_t> pending;
 	{
-		result[(unsigned int)w] = source.at((unsigned int)w);
-	}
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		for (std::size_t i = 0; i < cells.size(); i++)
+		{
+			if ((cells[i] & page_rect).empty())
+				continue;
 
-	return result;
-}
+			keys[i] = get_word_key(page(cells[i] & page_rect), mode, numbers_only, true);
+			if (const auto* cached = word_cache.find(keys[i]))
+				result[i] = *cached;
+			else
+				pending.push_back(i);
+		}
+	}
 
-std::vector<double> image_recognition::get_hu_moments(cv::Mat img)
-{
-	cv::Moments moments = cv::moments(detect_edges(img));
-	std::vector<double> hu_moments;
-	cv::HuMoments(moments, hu_moments);
+	// each engine receives the page once and recognizes a group of cells
+	std::size_t groups = (pending.size() + OCR_BATCH_SIZE - 1) / OCR_BATCH_SIZE;
+	parallel_for(groups, [&](std::size_t group)
+		{
+			try {
+				std::shared_ptr<tesseract::TessBaseAPI> cr = acquire_ocr();
+				cr->SetPageSegMode(mode);
+				cr->SetImage(page.data, page.cols, page.rows, static_cast<int>(page.elemSize()), static_cast<int>(page.step));
 
-	return hu_moments;
-}
+				for (std::size_t k = group * OCR_BATCH_SIZE; k < std::min(pending.size(), (group + 1) * OCR_BATCH_SIZE); k++)
+				{
+					cv::Rect cell = cells[pending[k]] & page_rect;
+					cr->SetRectangle(cell.x, cell.y, cell.width, cell.height);
+					cr->Recognize(0);
+					result[pending[k]] = get_words(*cr, cell.tl());
+				}
+			}
+			catch (...) {}
+		});
+
+	bool check_parity = false;
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		for (std::size_t i : pending)
+			word_cache.insert(keys[i], result[i]);
+		check_parity = parity_checks;
+	}
+
+	if (check_parity)
+	{
+		for (std::size_t i : pending)
+		{
+			std::string reference = join(detect_words(page(cells[i] & page_rect), mode, numbers_only), true);
+			std::string cell_string = join(result[i], true);
+
+			std::lock_guard<std::mutex> lock(cache_mutex);
+			cell_parity.checks++;
+			if (reference != cell_string)
+			{
+				cell_parity.mismatches++;
+				if (verbose)
+					std::cout << "cell read \"" << cell_string << "\" differs from \"" << reference << "\"" << std::endl;
+			}
+		}
+	}
+
+	return result;
+}
+
+cv::Mat image_recognition::compose_page(const std::vector<cv::Mat>& images, std::vector<cv::Rect>& cells)
+{
+	cells.clear();
+
+	int width = 0, height = 0, type = CV_8UC4;
+	for (const cv::Mat& img : images)
+	{
+		width = std::max(width, img.cols);
+		height += img.rows;
+		if (!img.empty())
+			type = img.type();
+	}
+
+	cv::Mat page(std::max(height, 1), std::max(width, 1), type, cv::Scalar::all(0));
+	int y = 0;
+	for (const cv::Mat& img : images)
+	{
+		cv::Mat converted = img;
+		if (!img.empty() && img.type() != type)
+			cv::cvtColor(img, converted, CV_MAT_CN(type) == 1 ? cv::COLOR_BGRA2GRAY : cv::COLOR_GRAY2BGRA);
+
+		cells.emplace_back(0, y, img.cols, img.rows);
+		if (!img.empty())
+			converted.copyTo(page(cells.back()));
+		y += img.rows;
+	}
+
+	return page;
+}
+
+std::vector<std::vector<std::pair<std::string, cv::Rect>>> image_recognition::detect_words_batch(const std::vector<cv::Mat>& images)
+{
+	std::vector<std::vector<std::pair<std::string, cv::Rect>>> result(images.size());
+
+	// batched results may differ from single image ones, keep them apart in the cache
+	const std::uint64_t batch_mode = combine_hash(static_cast<std::uint64_t>(tesseract::PSM_SINGLE_BLOCK) << 1 | 1,
+		std::hash<std::string>()(get_ocr_language()));
+
+	std::vector<std::uint64_t> keys(images.size());
+	std::vector<std::size_t> pending;
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		for (std::size_t i = 0; i < images.size(); i++)
+		{
+			if (images[i].empty())
+				continue;
+
+			keys[i] = combine_hash(combine_hash(hash_image(images[i]), images[i].type()), batch_mode);
+			if (const auto* cached = word_cache.find(keys[i]))
+				result[i] = *cached;
+			else
+				pending.push_back(i);
+		}
+	}
+
+	std::size_t pages = (pending.size() + OCR_BATCH_SIZE - 1) / OCR_BATCH_SIZE;
+	parallel_for(pages, [&](std::size_t page)
+		{
+			std::vector<std::size_t> members(pending.begin() + page * OCR_BATCH_SIZE,
+				pending.begin() + std::min(pending.size(), (page + 1) * OCR_BATCH_SIZE));
+			detect_words_page(images, members, result);
+		});
+
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	for (std::size_t i : pending)
+		word_cache.insert(keys[i], result[i]);
+
+	return result;
+}
+
+void image_recognition::detect_words_page(const std::vector<cv::Mat>& images,
+	const std::vector<std::size_t>& members,
+	std::vector<std::vector<std::pair<std::string, cv::Rect>>>& result)
+{
+	if (members.empty())
+		return;
+
+	// stack the images with their background color as separator,
+	// so that every image becomes one line of a text block
+	// gray cells are kept at one byte per pixel
+	int width = 0, height = 0, type = CV_8UC1;
+	for (std::size_t i : members)
+	{
+		width = std::max(width, images[i].cols);
+		height = std::max(height, images[i].rows);
+		if (images[i].channels() != 1)
+			type = CV_8UC4;
+	}
+	const int padding = std::max(8, height / 2);
+
+	std::vector<int> offsets; // top of each image in the page
+	cv::Mat page(static_cast<int>(members.size()) * (height + padding) + padding, width + 2 * padding, type, cv::Scalar::all(255));
+	int y = padding;
+	for (std::size_t i : members)
+	{
+		cv::Mat img = images[i];
+		if (img.type() != type)
+			cv::cvtColor(img, img, cv::COLOR_GRAY2BGRA);
+		cv::Scalar background = type == CV_8UC1 ? cv::Scalar::all(img.at<unsigned char>(0, 0)) : cv::Scalar(img.at<cv::Vec4b>(0, 0));
+
+		page(cv::Rect(0, y - padding / 2, page.cols, img.rows + padding)).setTo(background);
+		img.copyTo(page(cv::Rect(padding, y, img.cols, img.rows)));
+
+		offsets.push_back(y);
+		y += img.rows + padding;
+	}
+
+	try {
+		std::shared_ptr<tesseract::TessBaseAPI> cr = acquire_ocr();
+		cr->SetPageSegMode(tesseract::PSM_SINGLE_BLOCK);
+		cr->SetImage(page.data, page.cols, page.rows, static_cast<int>(page.elemSize()), static_cast<int>(page.step));
+		cr->Recognize(0);
+
+		tesseract::ResultIterator* ri = cr->GetIterator();
+		tesseract::PageIteratorLevel level = tesseract::RIL_WORD;
+
+		if (ri != 0) {
+			do {
+				const char* word = ri->GetUTF8Text(level);
+
+				int x1, y1, x2, y2;
+				ri->BoundingBox(level, &x1, &y1, &x2, &y2);
+
+				// assign the word to the image whose strip contains its center
+				int center = (y1 + y2) / 2;
+				std::size_t k = std::upper_bound(offsets.begin(), offsets.end(), center + padding / 2) - offsets.begin();
+				k = k ? k - 1 : 0;
+
+				std::string word_s = word ? std::string(word) : std::string();
+				cv::Rect aa_bb(cv::Point(x1 - padding, y1 - offsets[k]), cv::Point(x2 - padding, y2 - offsets[k]));
+				result[members[k]].push_back(std::make_pair(word_s, aa_bb));
+				delete[] word;
+			} while (ri->Next(level));
+		}
+	}
+	catch (...) {}
+}
+
+
+
+bool image_recognition::has_language(const std::string& language) const
+{
+	return dictionaries.find(language) != dictionaries.end() && tesseract_languages.find(language) != tesseract_languages.end();
+}
+
+bool image_recognition::is_verbose() const
+{
+	return verbose;
+}
+
+const keyword_dictionary& image_recognition::get_dictionary() const
+{
+	auto iter = dictionaries.find(get_ocr_language());
+	if (iter == dictionaries.end())
+		throw std::exception("language not found");
+	return iter->second;
+}
+
+std::map<unsigned int, std::string>  image_recognition::make_dictionary(const std::vector<phrase>& list) const
+{
+	std::map<unsigned int, std::string> result;
+	const std::map<unsigned int, std::string>& source = get_dictionary().ui_texts;
+
+	for (phrase w : list)
+	{
+		result[(unsigned int)w] = source.at((unsigned int)w);
+	}
+
+	return result;
+}
+
+std::vector<double> image_recognition::get_hu_moments(cv::Mat img)
+{
+	cv::Moments moments = cv::moments(detect_edges(img));
+	std::vector<double> hu_moments;
+	cv::HuMoments(moments, hu_moments);
+
+	return hu_moments;
+}
 
 cv::Mat image_recognition::detect_edges(const cv::Mat& im)
 {
@@ -1444,12 +2013,170 @@ std::vector<cv::Rect2i> image_recognition::detect_boxes(const cv::Mat& im, unsig
 	return boxes;
 	}
 
-std::vector<int> image_recognition::find_horizontal_lines(const cv::Mat& im, float line_density)
+int image_recognition::count_box_borders(const cv::Mat& gray, const cv::Rect2i& box, int tolerance)
+{
+	// a step of this height exceeds the lower Canny threshold of detect_boxes
+	const int threshold = 25;
+	const int probes = 8;
+
+	if (gray.channels() != 1 || box.width < probes || box.height < probes)
+		return 0;
+
+	// tests for a step between (y - dy, x - dx) and (y, x) close to the probe
+	auto is_edge = [&](int y, int x, int dy, int dx)
+	{
+		for (int d = -tolerance; d <= tolerance; d++)
+		{
+			int y1 = y + d * dy, x1 = x + d * dx;
+			int y0 = y1 - dy, x0 = x1 - dx;
+			if (y0 < 0 || x0 < 0 || y1 >= gray.rows || x1 >= gray.cols)
+				continue;
+
+			if (std::abs(static_cast<int>(gray.at<unsigned char>(y1, x1)) - gray.at<unsigned char>(y0, x0)) >= threshold)
+				return true;
+		}
+		return false;
+	};
+
+	// the border is found if three quarters of the probes hit an edge
+	auto is_border = [&](int y, int x, int dy, int dx)
+	{
+		int length = dy ? box.width : box.height;
+		int hits = 0;
+		for (int i = 0; i < probes; i++)
+		{
+			int offset = (2 * i + 1) * length / (2 * probes);
+			if (is_edge(y + dx * offset, x + dy * offset, dy, dx))
+				hits++;
+		}
+		return 4 * hits >= 3 * probes;
+	};
+
+	return is_border(box.y, box.x, 1, 0) +
+		is_border(box.y + box.height, box.x, 1, 0) +
+		is_border(box.y, box.x, 0, 1) +
+		is_border(box.y, box.x + box.width, 0, 1);
+}
+
+void image_recognition::set_geometry_height(int height)
+{
+	geometry_height = std::max(0, height);
+}
+
+double image_recognition::get_geometry_scale() const
+{
+	if (geometry_height <= 0 || resolution.height <= geometry_height)
+		return 1.;
+
+	return static_cast<double>(geometry_height) / resolution.height;
+}
+
+cv::Mat image_recognition::downscale(const cv::Mat& im, double scale)
+{
+	if (scale >= 1. || im.empty())
+		return im;
+
+	cv::Size size(std::max(1, static_cast<int>(std::lround(im.cols * scale))),
+		std::max(1, static_cast<int>(std::lround(im.rows * scale))));
+
+	cv::Mat scaled;
+	cv::resize(im, scaled, size, 0, 0, cv::INTER_AREA);
+	return scaled;
+}
+
+std::vector<cv::Rect2i> image_recognition::detect_boxes_normalized(const cv::Mat& im, const cv::Rect2i& box, const cv::Rect2i& ignore_region, float tolerance) const
+{
+	const double scale = get_geometry_scale();
+	if (scale >= 1.)
+		return detect_boxes(im, box, ignore_region, tolerance);
+
+	auto scale_rect = [](const cv::Rect2i& rect, double factor)
+	{
+		auto round = [factor](int value) { return static_cast<int>(std::lround(value * factor)); };
+		return cv::Rect2i(round(rect.x), round(rect.y), round(rect.width), round(rect.height));
+	};
+
+	std::vector<cv::Rect2i> boxes = detect_boxes(downscale(im, scale), scale_rect(box, scale), scale_rect(ignore_region, scale), tolerance);
+	for (cv::Rect2i& bb : boxes)
+		bb = scale_rect(bb, 1. / scale) & cv::Rect2i(0, 0, im.cols, im.rows);
+
+	return boxes;
+}
+
+std::vector<int> image_recognition::find_horizontal_lines_normalized(const cv::Mat& im) const
+{
+	const double scale = get_geometry_scale();
+	if (scale >= 1.)
+		return find_horizontal_lines(im);
+
+	std::vector<int> lines = find_horizontal_lines(downscale(im, scale));
+
+	std::vector<int> centers(lines.size());
+	for (std::size_t i = 0; i < lines.size(); i++)
+		centers[i] = static_cast<int>(std::lround(lines[i] / scale));
+
+	// row_grid_tracker verifies the exact rows, so look for the edge at full resolution
+	// in a window that ends halfway to the neighbouring lines
+	const int radius = static_cast<int>(std::ceil(1. / scale));
+	std::vector<unsigned char> edges(im.cols);
+	for (std::size_t i = 0; i < lines.size(); i++)
+	{
+		int begin = std::max(1, centers[i] - radius);
+		int end = std::min(im.rows - 1, centers[i] + radius);
+		if (i > 0)
+			begin = std::max(begin, (centers[i - 1] + centers[i]) / 2 + 1);
+		if (i + 1 < lines.size())
+			end = std::min(end, (centers[i] + centers[i + 1]) / 2);
+
+		lines[i] = centers[i];
+		if (begin > end)
+			continue;
+
+		cv::Mat gray = to_gray(im.rowRange(begin - 1, end + 1));
+		int best = 0;
+		for (int y = begin; y <= end; y++)
+		{
+			int count = horizontal_line_detector::mark_edges(gray.ptr<unsigned char>(y - begin), gray.ptr<unsigned char>(y - begin + 1),
+				edges.data(), im.cols, horizontal_line_detector::EDGE_THRESHOLD);
+			if (count > best)
+			{
+				best = count;
+				lines[i] = y;
+			}
+		}
+	}
+
+	return lines;
+}
+
+std::vector<int> image_recognition::find_horizontal_lines(const cv::Mat& im, float line_density, line_detection method)
 {
 #ifdef SHOW_CV_DEBUG_IMAGE_VIEW
 	cv::imwrite("debug_images/scroll_area.png", im);
 #endif
 
+	if (method == line_detection::PROJECTION)
+	{
+		std::vector<int> hlines = horizontal_line_detector::find_lines(to_gray(im), line_density);
+
+#ifdef SHOW_CV_DEBUG_IMAGE_VIEW
+		// validate against the Hough detector
+		std::vector<int> hough_lines = find_horizontal_lines(im, line_density, line_detection::HOUGH);
+		if (hlines != hough_lines)
+		{
+			std::cout << "line detection differs, projection:";
+			for (int line : hlines)
+				std::cout << " " << line;
+			std::cout << ", hough:";
+			for (int line : hough_lines)
+				std::cout << " " << line;
+			std::cout << std::endl;
+		}
+#endif
+
+		return hlines;
+	}
+
 	cv::Mat edges = detect_edges(im);
 
 #ifdef SHOW_CV_DEBUG_IMAGE_VIEW
@@ -1473,12 +2200,22 @@ std::vector<int> image_recognition::find_horizontal_lines(const cv::Mat& im, flo
 }
 
 void image_recognition::iterate_rows(const cv::Mat& im, float line_density,
-	const std::function<void(const cv::Mat& row)> f)
+	const std::function<void(const cv::Mat& row)> f) const
 {
-	std::vector<int> lines(find_horizontal_lines(im));
+	for (const cv::Mat& row : get_rows(im, line_density))
+		f(row);
+}
+
+std::vector<cv::Mat> image_recognition::get_rows(const cv::Mat& im, float line_density) const
+{
+	std::vector<cv::Mat> rows;
+	std::vector<int> lines(row_grids.get_lines(im, line_density, [this](const cv::Mat& pane)
+		{
+			return find_horizontal_lines_normalized(pane);
+		}));
 
 	if (!lines.size())
-		return;
+		return rows;
 
 	std::vector<int> heights;
 	int prev_hline = 0;
@@ -1494,7 +2231,7 @@ void image_recognition::iterate_rows(const cv::Mat& im, float line_density,
 
 	std::sort(heights.begin(), heights.end());
 	if (heights.empty())
-		return;
+		return rows;
 
 	prev_hline = 0;
 	int mean_row_height = heights[heights.size() / 2];
@@ -1519,7 +2256,7 @@ void image_recognition::iterate_rows(const cv::Mat& im, float line_density,
 		if (height > 0.9 * mean_row_height && height < 1.1 * mean_row_height)
 		{
 			row_height = height;
-			f(im(cv::Rect(0, prev_hline, im.cols, height)));
+			rows.push_back(im(cv::Rect(0, prev_hline, im.cols, height)));
 		}
 		else
 			next_hline = hline;
@@ -1531,16 +2268,57 @@ void image_recognition::iterate_rows(const cv::Mat& im, float line_density,
 	{
 		int height = lines.back() + row_height < im.rows ? row_height : im.rows - lines.back();
 		if (height > 10 && height > row_height * 0.95f)
-			f(im(cv::Rect(0, lines.back(), im.cols, height)));
+			rows.push_back(im(cv::Rect(0, lines.back(), im.cols, height)));
+	}
+
+	return rows;
+}
+
+void image_recognition::parallel_for(std::size_t count, const std::function<void(std::size_t)>& f) const
+{
+	if (verbose || count < MIN_PARALLEL_COUNT)
+	{
+		for (std::size_t i = 0; i < count; i++)
+			f(i);
+		return;
 	}
+
+	workers.parallel_for(count, f);
 }
 
 
 
 
-int image_recognition::number_from_region(const cv::Mat& im)
+std::uint64_t image_recognition::get_number_key(const cv::Mat& im, bool cell) const
 {
-	std::string number_string = join(detect_words(im, tesseract::PageSegMode::PSM_SINGLE_LINE, true));
+	return combine_hash(combine_hash(hash_image(im), static_cast<std::uint64_t>(im.type()) << 1 | cell),
+		std::hash<std::string>()(get_ocr_language()));
+}
+
+int image_recognition::number_from_region(const cv::Mat& im, const std::string& characters)
+{
+	std::uint64_t key = get_number_key(im);
+	std::string number_string;
+	bool recognized = false;
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		if (const int* cached = number_cache.find(key))
+		{
+			if (verbose)
+				std::cout << " (" << *cached << ") ";
+			return *cached;
+		}
+
+		recognized = digits.recognize(im, number_string, characters);
+	}
+
+	if (!recognized)
+	{
+		number_string = join(detect_words(im, tesseract::PageSegMode::PSM_SINGLE_LINE, true));
+
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		digits.learn(im, number_string);
+	}
 
 #ifdef CONSOLE_DEBUG_OUTPUT
 	std::cout << number_string << "\t";
@@ -1550,9 +2328,92 @@ int image_recognition::number_from_region(const cv::Mat& im)
 	if (verbose)
 		std::cout << " (" << number_string << ", " << number << ") ";
 
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	number_cache.insert(key, number);
 	return number;
 }
 
+std::vector<int> image_recognition::numbers_from_regions(const std::vector<cv::Mat>& images, const std::string& characters)
+{
+	return read_numbers(images, [&](const std::vector<std::size_t>& indices)
+		{
+			std::vector<cv::Mat> pending;
+			for (std::size_t i : indices)
+				pending.push_back(images[i]);
+
+			return detect_words_batch(pending);
+		}, false, characters);
+}
+
+std::vector<int> image_recognition::numbers_from_cells(const cv::Mat& page, const std::vector<cv::Rect>& cells, const std::string& characters)
+{
+	std::vector<cv::Mat> images;
+	for (const cv::Rect& cell : cells)
+		images.push_back(page(cell));
+
+	return read_numbers(images, [&](const std::vector<std::size_t>& indices)
+		{
+			std::vector<cv::Rect> pending;
+			for (std::size_t i : indices)
+				pending.push_back(cells[i]);
+
+			return detect_words_in_cells(page, pending, tesseract::PageSegMode::PSM_SINGLE_LINE, true);
+		}, true, characters);
+}
+
+std::vector<int> image_recognition::read_numbers(const std::vector<cv::Mat>& images,
+	const std::function<std::vector<std::vector<std::pair<std::string, cv::Rect>>>(const std::vector<std::size_t>&)>& ocr,
+	bool cells, const std::string& characters)
+{
+	std::vector<int> result(images.size(), std::numeric_limits<int>::lowest());
+	std::vector<std::uint64_t> keys(images.size());
+
+	std::vector<std::size_t> pending;
+	std::vector<std::string> number_strings(images.size());
+	std::vector<bool> evaluated(images.size(), false);
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		for (std::size_t i = 0; i < images.size(); i++)
+		{
+			keys[i] = get_number_key(images[i], cells);
+			if (const int* cached = number_cache.find(keys[i]))
+			{
+				result[i] = *cached;
+				continue;
+			}
+
+			evaluated[i] = true;
+			if (!digits.recognize(images[i], number_strings[i], characters))
+				pending.push_back(i);
+		}
+	}
+
+	std::vector<std::vector<std::pair<std::string, cv::Rect>>> texts;
+	if (!pending.empty())
+		texts = ocr(pending);
+
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	for (std::size_t k = 0; k < pending.size(); k++)
+	{
+		number_strings[pending[k]] = join(texts[k]);
+		digits.learn(images[pending[k]], number_strings[pending[k]]);
+	}
+
+	for (std::size_t i = 0; i < images.size(); i++)
+	{
+		if (!evaluated[i])
+			continue;
+
+		result[i] = number_from_string(number_strings[i]);
+		if (verbose)
+			std::cout << " (" << number_strings[i] << ", " << result[i] << ") ";
+
+		number_cache.insert(keys[i], result[i]);
+	}
+
+	return result;
+}
+
 int image_recognition::number_from_string(const std::string& word)
 {
 	std::string number_string = word;
@@ -1578,39 +2439,83 @@ std::pair<int, int> image_recognition::read_number_slash_number(const cv::Mat& i
 {
 	std::vector<std::string> number_strings;
 
+	std::string recognized_string;
+	bool recognized = false;
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		recognized = digits.recognize(im, recognized_string, digit_recognizer::FRACTIONS);
+	}
+
+	if (recognized)
+	{
+		if (verbose)
+			std::cout << "\t" << recognized_string;
+
+		number_strings = split_recognized_number_slash_number(recognized_string);
+	}
+
 	for (const auto& mode : { tesseract::PSM_SINGLE_LINE, tesseract::PSM_SINGLE_WORD, tesseract::PSM_RAW_LINE })
 	{
+		if (!number_strings.empty())
+			break;
+
 		std::vector<std::pair<std::string, cv::Rect>> texts = detect_words(im, mode);
 		std::string joined_string = join(texts);
+		{
+			std::lock_guard<std::mutex> lock(cache_mutex);
+			digits.learn(im, joined_string);
+		}
 
 		if (verbose)
 			std::cout << "\t" << joined_string;
 
-		std::vector<std::string> split_string;
-		boost::split(split_string, joined_string, [](char c) {return c == '/' || c == '[' || c == '(' || c == '{'; });
+		number_strings = split_number_slash_number(texts);
+	}
 
+	return parse_number_slash_number(number_strings);
+}
 
-		if (split_string.size() == 2 && std::regex_match(split_string.front(), std::regex("(\\d|\\s|[,.;:'M])+")))
-			number_strings = split_string;
-		else if ((texts.size() == 2 || texts.size() == 3 && texts[1].first.size() == 1) &&
-			std::regex_match(texts.front().first, std::regex("(\\d|\\s|[,.;:'M])+")))
-		{
-			number_strings.push_back(texts.front().first);
-			if (texts.size() == 3)
-				number_strings.push_back(texts[2].first);
-			else
-				number_strings.push_back(texts[1].first);
-		}
+std::vector<std::string> image_recognition::split_number_slash_number(const std::vector<std::pair<std::string, cv::Rect>>& texts) const
+{
+	std::vector<std::string> number_strings;
+	std::string joined_string = join(texts);
 
-		if (!number_strings.empty())
-			break;
+	std::vector<std::string> split_string;
+	boost::split(split_string, joined_string, [](char c) {return c == '/' || c == '[' || c == '(' || c == '{'; });
+
+
+	if (split_string.size() == 2 && std::regex_match(split_string.front(), std::regex("(\\d|\\s|[,.;:'M])+")))
+		number_strings = split_string;
+	else if ((texts.size() == 2 || texts.size() == 3 && texts[1].first.size() == 1) &&
+		std::regex_match(texts.front().first, std::regex("(\\d|\\s|[,.;:'M])+")))
+	{
+		number_strings.push_back(texts.front().first);
+		if (texts.size() == 3)
+			number_strings.push_back(texts[2].first);
+		else
+			number_strings.push_back(texts[1].first);
 	}
 
-	if (number_strings.empty())
+	return number_strings;
+}
+
+std::vector<std::string> image_recognition::split_recognized_number_slash_number(const std::string& text)
+{
+	std::vector<std::string> split_string;
+	boost::split(split_string, text, [](char c) {return c == '/'; });
+	if (split_string.size() == 2 && !split_string.front().empty() && !split_string.back().empty())
+		return split_string;
+
+	return std::vector<std::string>();
+}
+
+std::pair<int, int> image_recognition::parse_number_slash_number(std::vector<std::string> number_strings)
+{
+	if (number_strings.size() != 2)
 		return std::make_pair(std::numeric_limits<int>::lowest(), std::numeric_limits<int>::lowest());
 
 	for (auto& number_string : number_strings)
-		if (number_string.back() == 'M')
+		if (!number_string.empty() && number_string.back() == 'M')
 		{
 			number_string.pop_back();
 			number_string += "0000";
@@ -1619,51 +2524,119 @@ std::pair<int, int> image_recognition::read_number_slash_number(const cv::Mat& i
 	return std::make_pair(number_from_string(number_strings[0]), number_from_string(number_strings[1]));
 }
 
+std::vector<std::pair<int, int>> image_recognition::read_numbers_slash_numbers(const std::vector<cv::Mat>& images)
+{
+	std::vector<std::pair<int, int>> result(images.size(),
+		std::make_pair(std::numeric_limits<int>::lowest(), std::numeric_limits<int>::lowest()));
+
+	std::vector<cv::Mat> pending;
+	std::vector<std::size_t> pending_indices;
+	for (std::size_t i = 0; i < images.size(); i++)
+	{
+		std::string recognized_string;
+		bool recognized = false;
+		{
+			std::lock_guard<std::mutex> lock(cache_mutex);
+			recognized = digits.recognize(images[i], recognized_string, digit_recognizer::FRACTIONS);
+		}
 
+		std::vector<std::string> number_strings;
+		if (recognized)
+			number_strings = split_recognized_number_slash_number(recognized_string);
 
+		if (number_strings.empty())
+		{
+			pending.push_back(images[i]);
+			pending_indices.push_back(i);
+		}
+		else
+		{
+			result[i] = parse_number_slash_number(number_strings);
+		}
+	}
 
+	std::vector<std::vector<std::pair<std::string, cv::Rect>>> texts = detect_words_batch(pending);
+	for (std::size_t k = 0; k < pending.size(); k++)
+	{
+		{
+			std::lock_guard<std::mutex> lock(cache_mutex);
+			digits.learn(pending[k], join(texts[k]));
+		}
 
+		std::vector<std::string> number_strings = split_number_slash_number(texts[k]);
+		if (number_strings.empty())
+			result[pending_indices[k]] = read_number_slash_number(pending[k]); // try all page segmentation modes
+		else
+			result[pending_indices[k]] = parse_number_slash_number(number_strings);
+	}
 
-// Function to find length of Longest Common Subsequence of substring
-// X[0..m-1] and Y[0..n-1]
-// From https://www.techiedelight.com/longest-common-subsequence/
-int image_recognition::lcs_length(std::string X, std::string Y)
+	return result;
+}
+
+std::vector<std::pair<int, int>> image_recognition::read_numbers_slash_numbers(const cv::Mat& page, const std::vector<cv::Rect>& cells)
 {
-	int m = X.length(), n = Y.length();
+	std::vector<std::pair<int, int>> result(cells.size(),
+		std::make_pair(std::numeric_limits<int>::lowest(), std::numeric_limits<int>::lowest()));
 
-	// lookup table stores solution to already computed sub-problems
-	// i.e. lookup[i][j] stores the length of LCS of substring
-	// X[0..i-1] and Y[0..j-1]
-	std::vector<std::vector<int>> lookup;
-	lookup.resize(m + 1);
-	for (auto& row : lookup)
-		row.resize(n + 1);
+	std::vector<std::size_t> pending;
+	for (std::size_t i = 0; i < cells.size(); i++)
+	{
+		std::string recognized_string;
+		bool recognized = false;
+		{
+			std::lock_guard<std::mutex> lock(cache_mutex);
+			recognized = digits.recognize(page(cells[i]), recognized_string, digit_recognizer::FRACTIONS);
+		}
 
-	// first column of the lookup table will be all 0
-	for (int i = 0; i <= m; i++)
-		lookup[i][0] = 0;
+		std::vector<std::string> number_strings;
+		if (recognized)
+			number_strings = split_recognized_number_slash_number(recognized_string);
 
-	// first row of the lookup table will be all 0
-	for (int j = 0; j <= n; j++)
-		lookup[0][j] = 0;
+		if (number_strings.empty())
+			pending.push_back(i);
+		else
+			result[i] = parse_number_slash_number(number_strings);
+	}
 
-	// fill the lookup table in bottom-up manner
-	for (int i = 1; i <= m; i++)
+	// same sequence of page segmentation modes as read_number_slash_number
+	for (const auto& mode : { tesseract::PSM_SINGLE_LINE, tesseract::PSM_SINGLE_WORD, tesseract::PSM_RAW_LINE })
 	{
-		for (int j = 1; j <= n; j++)
+		if (pending.empty())
+			break;
+
+		std::vector<cv::Rect> pending_cells;
+		for (std::size_t i : pending)
+			pending_cells.push_back(cells[i]);
+
+		std::vector<std::vector<std::pair<std::string, cv::Rect>>> texts = detect_words_in_cells(page, pending_cells, mode);
+		std::vector<std::size_t> failed;
+		for (std::size_t k = 0; k < pending.size(); k++)
 		{
-			// if current character of X and Y matches
-			if (X[i - 1] == Y[j - 1])
-				lookup[i][j] = lookup[i - 1][j - 1] + 1;
+			std::string joined_string = join(texts[k]);
+			{
+				std::lock_guard<std::mutex> lock(cache_mutex);
+				digits.learn(page(cells[pending[k]]), joined_string);
+			}
 
-			// else if current character of X and Y don't match
+			if (verbose)
+				std::cout << "\t" << joined_string;
+
+			std::vector<std::string> number_strings = split_number_slash_number(texts[k]);
+			if (number_strings.empty())
+				failed.push_back(pending[k]);
 			else
-				lookup[i][j] = std::max(lookup[i - 1][j], lookup[i][j - 1]);
+				result[pending[k]] = parse_number_slash_number(number_strings);
 		}
+
+		pending = failed;
 	}
 
-	// LCS will be last entry in the lookup table
-	return lookup[m][n];
+	return result;
+}
+
+int image_recognition::lcs_length(std::string X, std::string Y)
+{
+	return lcs_pattern(X).lcs_length(Y);
 }
 
 std::string image_recognition::join(const std::vector<std::pair<std::string, cv::Rect>>& words, bool insert_spaces) const
@@ -1685,17 +2658,47 @@ std::string image_recognition::join(const std::vector<std::pair<std::string, cv:
 
 void image_recognition::update_ocr(const std::string& language/*, bool numbers_only*/)
 {
-	if (ocr && !ocr_language.compare(language) /*&& numbers_only == number_mode*/)
-		return;
+	std::string selected_language;
+	{
+		std::lock_guard<std::mutex> lock(ocr_mutex);
 
-	if (verbose) {
-		std::cout << "Update tesseract language " << language /*<< " number only " << numbers_only*/ << std::endl;
+		auto iter = ocr_pool.find(language);
+		if (iter != ocr_pool.end() && !ocr_language.compare(language) /*&& numbers_only == number_mode*/)
+			return;
+
+		if (verbose) {
+			std::cout << "Update tesseract language " << language /*<< " number only " << numbers_only*/ << std::endl;
+		}
+
+		ocr_language = tesseract_languages.find(language) != tesseract_languages.end() ? language : "english";
+		//number_mode = numbers_only;
+
+		// engines of other languages that are currently in use return to the pool and are dropped on the next switch
+		for (auto pool = ocr_pool.begin(); pool != ocr_pool.end(); )
+		{
+			if (pool->first == ocr_language)
+				++pool;
+			else
+				pool = ocr_pool.erase(pool);
+		}
+
+		if (!ocr_pool[ocr_language].empty())
+			return;
+		selected_language = ocr_language;
 	}
 
+	// initializing takes long, don't block the threads that read ocr_language
+	std::unique_ptr<tesseract::TessBaseAPI> engine = create_ocr(selected_language);
 
+	std::lock_guard<std::mutex> lock(ocr_mutex);
+	ocr_pool[selected_language].push_back(std::move(engine));
+}
 
-	const char* lang = tesseract_languages.find(language)->second.c_str();
-	ocr.reset(new tesseract::TessBaseAPI());
+std::unique_ptr<tesseract::TessBaseAPI> image_recognition::create_ocr(const std::string& language) const
+{
+	auto iter = tesseract_languages.find(language);
+	const char* lang = iter != tesseract_languages.end() ? iter->second.c_str() : nullptr;
+	std::unique_ptr<tesseract::TessBaseAPI> ocr(new tesseract::TessBaseAPI());
 
 	GenericVector<STRING> keys;
 	GenericVector<STRING> values;
@@ -1727,9 +2730,39 @@ void image_recognition::update_ocr(const std::string& language/*, bool numbers_o
 	}
 
 	//		ocr_->SetVariable("CONFIGFILE", "bazaar");
-	ocr_language = lang ? language : "english";
-	//number_mode = numbers_only;
+	return ocr;
+}
+
+std::string image_recognition::get_ocr_language() const
+{
+	std::lock_guard<std::mutex> lock(ocr_mutex);
+	return ocr_language;
+}
+
+std::shared_ptr<tesseract::TessBaseAPI> image_recognition::acquire_ocr()
+{
+	std::unique_ptr<tesseract::TessBaseAPI> engine;
+	std::string language;
+	{
+		std::lock_guard<std::mutex> lock(ocr_mutex);
+		language = ocr_language;
+
+		auto& idle = ocr_pool[language];
+		if (!idle.empty())
+		{
+			engine = std::move(idle.back());
+			idle.pop_back();
+		}
+	}
+
+	// initializing takes long, don't block other threads
+	if (!engine)
+		engine = create_ocr(language);
 
+	return std::shared_ptr<tesseract::TessBaseAPI>(engine.release(), [this, language](tesseract::TessBaseAPI* released) {
+		std::lock_guard<std::mutex> lock(ocr_mutex);
+		ocr_pool[language].emplace_back(released);
+	});
 }
 
 const std::map<std::string, std::string> image_recognition::tesseract_languages = {
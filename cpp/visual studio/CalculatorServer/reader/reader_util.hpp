@@ -1,11 +1,14 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include <list>
 #include <vector>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <shared_mutex>
 #include <string>
 
 #include <opencv2/core/mat.hpp>
@@ -13,6 +16,16 @@
 
 #include <tesseract/baseapi.h>
 
+#include "reader_digit_recognizer.hpp"
+#include "reader_frame.hpp"
+#include "reader_icon_atlas.hpp"
+#include "reader_icon_hash.hpp"
+#include "reader_lru_cache.hpp"
+#include "reader_row_grid.hpp"
+#include "reader_screen_classifier.hpp"
+#include "reader_text_matching.hpp"
+#include "reader_worker_pool.hpp"
+
 // #define SHOW_CV_DEBUG_IMAGE_VIEW
 // #define CONSOLE_DEBUG_OUTPUT
 
@@ -29,6 +42,16 @@ struct keyword_dictionary
 	std::map<unsigned int, std::string> traders;
 };
 
+/*
+* Number of results compared against a reference implementation
+* and the number of those that differed
+*/
+struct parity_statistics
+{
+	std::size_t checks = 0;
+	std::size_t mismatches = 0;
+};
+
 class image_recognition;
 
 struct item
@@ -104,6 +127,16 @@ public:
 	* Returns the region of @param{img} specified by a subregion of [0,1]
 	*/
 	static cv::Mat get_pane(const cv::Rect2f& rect, const cv::Mat& img);
+	/*
+	* Returns the pixel rectangle of the pane @param{rect} in an image of @param{size}
+	*/
+	static cv::Rect get_pane_location(const cv::Rect2f& rect, const cv::Size& size);
+
+	/*
+	* Returns the region of @param{target} that corresponds to @param{region},
+	* which must be a view into @param{source} (e.g. a row of a pane)
+	*/
+	static cv::Mat get_corresponding_region(const cv::Mat& region, const cv::Mat& source, const cv::Mat& target);
 
 	static bool closer_to(const cv::Scalar& color, const cv::Scalar& ref, const cv::Scalar& other);
 
@@ -122,11 +155,17 @@ public:
 	void initialize_items();
 
 	/**
-	* creates BGRA image with only black and white pixels
+	* creates BGRA image (single channel if not multi_channel) with only black and white pixels
 	* thresholding is between two peeks of input image
+	* accepts BGRA and gray input, convert a pane once with to_gray to binarize many cells of it
 	*/
 	static cv::Mat binarize(const cv::Mat& input, bool invert = false, bool multi_channel = true, int threshold = -1);
 
+	/**
+	* converts a BGRA or BGR image to a single channel, returns gray input unchanged
+	*/
+	static cv::Mat to_gray(const cv::Mat& input);
+
 	/**
 	* creates BGRA image with only black and white pixels
 	* uses edge detection to get the largest closed monochrome spot
@@ -170,6 +209,14 @@ public:
 	static std::list<cv::Point> find_rgb_region(const cv::Mat& in,
 		const cv::Point& seed, float threshold);
 
+	/**
+	* same region as find_rgb_region, computed by a scanline flood fill
+	*
+	* return the axis-aligned bounding box of the region and its number of pixels
+	*/
+	static std::pair<cv::Rect, std::size_t> find_rgb_region_bounds(const cv::Mat& in,
+		const cv::Point& seed, float threshold);
+
 
 
 	/*
@@ -192,17 +239,76 @@ public:
 	/*
 	* Returns the GUID that best matches @param{icon}, resizes the icon if necessary.
 	* Returns 0 if there is no match.
+	* Entries listed in @param{preferred} are compared first, which speeds up
+	* the search if they are likely matches but does not change the result.
 	*/
 	std::vector<unsigned int> get_guid_from_icon(const cv::Mat& icon, 
 		const std::map<unsigned int, cv::Mat>& dictionary,
-		const cv::Mat& background) const;
+		const cv::Mat& background,
+		const std::vector<unsigned int>& preferred = std::vector<unsigned int>()) const;
 
 	std::vector<unsigned int> get_guid_from_hu_moments(const cv::Mat& icon, 
 		const std::map<unsigned int, std::vector<double>>& dictionary) const;
 
 	std::vector<unsigned int> get_guid_from_icon(const cv::Mat& icon,
 		const std::map<unsigned int, cv::Mat>& dictionary,
-		const cv::Scalar& background_color) const;
+		const cv::Scalar& background_color,
+		const std::vector<unsigned int>& preferred = std::vector<unsigned int>()) const;
+
+	/*
+	* Looks up the perceptual hash of @param{icon} in the index of all item icons.
+	* Returns the GUIDs of similar items, closest first.
+	*/
+	std::vector<unsigned int> get_item_candidates(const cv::Mat& icon, unsigned int max_distance = ITEM_HASH_DISTANCE) const;
+
+	/*
+	* Drops all cached icon templates
+	*/
+	void clear_icon_templates();
+
+	/*
+	* Returns a hash of the pixel values of @param{img}
+	*/
+	static std::uint64_t hash_image(const cv::Mat& img);
+
+	/*
+	* Mixes @param{value} into the hash @param{seed}
+	*/
+	static std::uint64_t combine_hash(std::uint64_t seed, std::uint64_t value);
+
+	/*
+	* Returns the hits and misses of the caches for the results of
+	* detect_words ("words"), number_from_region ("numbers"), get_guid_from_icon ("icons")
+	* and the remembered table lines ("row_grids") and menu titles ("screens").
+	* "digits" counts the numbers read with and without Tesseract, see digit_recognizer
+	*/
+	std::map<std::string, cache_statistics> get_cache_statistics() const;
+
+	/*
+	* Drops all cached recognition results
+	*/
+	void clear_result_caches();
+
+	/*
+	* Drops the remembered table lines, e.g. when another island or tab is selected
+	*/
+	void clear_row_grids();
+
+	/*
+	* While enabled, each OCR result of detect_words_in_cells is compared with
+	* detect_words on the cropped cell ("cells") and each result of get_guid_from_icon
+	* with an exhaustive template search ("icons"). Boxes passed to check_box_parity are
+	* compared with detect_boxes_normalized ("boxes"). Cached results are not checked,
+	* call clear_result_caches before. Slow, meant for the screenshot regression tests.
+	*/
+	void enable_parity_checks(bool enable);
+	std::map<std::string, parity_statistics> get_parity_statistics() const;
+
+	/*
+	* While parity checks are enabled, counts each box in @param{predicted} as a mismatch
+	* if no box that detect_boxes_normalized finds in @param{im} has all borders within one pixel
+	*/
+	void check_box_parity(const std::vector<cv::Rect2i>& predicted, const cv::Mat& im, const cv::Rect2i& box, const cv::Rect2i& ignore_region) const;
 
 	/*
 	* Returns the session id or 0 in case of failure.
@@ -210,6 +316,12 @@ public:
 	*/
 	unsigned int get_session_guid(cv::Mat icon) const;
 
+	/*
+	* Resizes the binary image @param{silhouette} to SILHOUETTE_SIZE x SILHOUETTE_SIZE
+	* and packs it into a bit mask, one bit per non-zero pixel
+	*/
+	static std::vector<std::uint64_t> pack_silhouette(const cv::Mat& silhouette);
+
 	/*
 	* Performs text recognition on the input image.
 	* Returns the GUIDs of the best matching text or an empty vector in case of failure
@@ -218,8 +330,19 @@ public:
 	*/
 	std::vector<unsigned int> get_guid_from_name(const cv::Mat& text,
 		const std::map<unsigned int, std::string>& dictionary);
-	static std::vector<unsigned int> get_guid_from_name(const std::string& text,
-		const std::map<unsigned int, std::string>& dictionary);
+	/*
+	* Returns the GUIDs of the entries in @param{dictionary} that best match @param{text}
+	* Uses the precompiled matcher if @param{dictionary} is one of the loaded dictionaries
+	*/
+	std::vector<unsigned int> get_guid_from_name(const std::string& text,
+		const std::map<unsigned int, std::string>& dictionary) const;
+
+	/*
+	* Tests whether @param{pane} (BGRA) shows the heading @param{title}.
+	* Compares a fingerprint of @param{pane} with the headings recognized before
+	* and runs OCR only if that is inconclusive.
+	*/
+	bool has_title(const cv::Mat& pane, phrase title);
 
 	template <typename T>
 	static cv::Point_<T> get_center(const cv::Rect_<T> box)
@@ -245,7 +368,11 @@ public:
 	static std::pair<cv::Rect, float> match_template(const cv::Mat& source, const cv::Mat& template_img);
 
 
-	void update(const std::string& language = std::string("english"));
+	/*
+	* Switches OCR to @param{language}
+	* A changed @param{resolution} invalidates all cached icon templates
+	*/
+	void update(const std::string& language = std::string("english"), const cv::Size& resolution = cv::Size());
 	
 	/**
 	* makes a screenshot from the Anno 7.exe application 
@@ -264,6 +391,34 @@ public:
 		tesseract::PageSegMode mode = tesseract::PSM_SPARSE_TEXT,
 		bool numbers_only = false);
 
+	/**
+	* detect the words of several single line BGRA images [images]
+	* the images are stacked into pages of up to OCR_BATCH_SIZE lines, each page is
+	* recognized by a single Tesseract run (pages run concurrently)
+	*
+	* return the detected words per image, bounding boxes are relative to that image
+	*/
+	std::vector<std::vector<std::pair<std::string, cv::Rect>>> detect_words_batch(const std::vector<cv::Mat>& images);
+
+	/**
+	* detect the words in the rectangles [cells] of the preprocessed image [page] (BGRA or gray)
+	* the page is handed to Tesseract once per engine, each cell is recognized by
+	* restricting recognition to its rectangle, results should equal detect_words(page(cell), mode)
+	* but are cached separately, see enable_parity_checks
+	*
+	* return the detected words per cell, bounding boxes are relative to that cell
+	*/
+	std::vector<std::vector<std::pair<std::string, cv::Rect>>> detect_words_in_cells(const cv::Mat& page,
+		const std::vector<cv::Rect>& cells,
+		tesseract::PageSegMode mode = tesseract::PSM_SINGLE_LINE,
+		bool numbers_only = false);
+
+	/*
+	* Places @param{images} below each other in one page for detect_words_in_cells
+	* and writes their locations to @param{cells}
+	*/
+	static cv::Mat compose_page(const std::vector<cv::Mat>& images, std::vector<cv::Rect>& cells);
+
 	/**
 	* Returns the length of the longest common subsequence of X and Y
 	*/
@@ -272,11 +427,15 @@ public:
 	std::string join(const std::vector<std::pair<std::string, cv::Rect>>& words, bool insert_sapces = false) const;
 
 	/**
-	* access to the singleton TessBaseAPI instance
+	* access to the pool of TessBaseAPI instances
+	* each thread running OCR acquires its own instance for ocr_language,
+	* the instance returns to the pool when the last copy of the pointer is destroyed
 	*/
 	//@{
 	void update_ocr(const std::string& language/*, bool numbers_only = false*/);
-	std::shared_ptr<tesseract::TessBaseAPI> ocr;
+	std::shared_ptr<tesseract::TessBaseAPI> acquire_ocr();
+	// copy of ocr_language taken under ocr_mutex, update_ocr may change it concurrently
+	std::string get_ocr_language() const;
 	std::string ocr_language;
 	//bool number_mode;
 	//@}
@@ -312,26 +471,116 @@ public:
 	static std::vector<cv::Rect2i> detect_boxes(const cv::Mat& im, unsigned int width, unsigned int height, const cv::Rect2i& ignore_region = cv::Rect2i(), float tolerance = 0.05f,
 		double threshold1 = 100, double threshold2 = 190);
 
+	/*
+	* Probes the four borders of @param{box} for an edge in @param{gray}, tolerating
+	* misalignments of up to @param{tolerance} pixels. Returns the number of borders found.
+	* Much cheaper than detect_boxes if the location of a box is known in advance.
+	*/
+	static int count_box_borders(const cv::Mat& gray, const cv::Rect2i& box, int tolerance = 3);
+
+	/*
+	* Contours, table lines and templates are detected on panes scaled down to a
+	* screenshot height of @param{height} pixels if the screenshot is higher.
+	* OCR still reads full resolution crops. 0 disables the scaling (default).
+	*/
+	void set_geometry_height(int height);
+
+	/*
+	* Factor <= 1 from the current resolution to the one used for geometry detection
+	*/
+	double get_geometry_scale() const;
+
+	/*
+	* Returns @param{im} scaled by @param{scale} with area interpolation,
+	* @param{im} itself if @param{scale} >= 1
+	*/
+	static cv::Mat downscale(const cv::Mat& im, double scale);
+
+	/*
+	* Same as detect_boxes, but runs on @param{im} scaled by get_geometry_scale().
+	* Returns boxes in coordinates of @param{im}.
+	*/
+	std::vector<cv::Rect2i> detect_boxes_normalized(const cv::Mat& im, const cv::Rect2i& box, const cv::Rect2i& ignore_region = cv::Rect2i(), float tolerance = 0.05f) const;
+
+	/*
+	* find_horizontal_lines on @param{im} scaled by get_geometry_scale(),
+	* each line is moved to the strongest edge row of @param{im} close to it.
+	* Rows closer to a neighbouring line belong to that line, so lines never merge.
+	*/
+	std::vector<int> find_horizontal_lines_normalized(const cv::Mat& im) const;
+
+	enum class line_detection
+	{
+		HOUGH, // Canny edges and HoughLinesP
+		PROJECTION // edge projection per row, see horizontal_line_detector
+	};
+
 	/*
 	* Detects contours in the image and filters width wide horizontal lines
 	* @param{line_ensity} is the prercentage of set pixels per row to recognize it as a line
 	*/
-	static std::vector<int> find_horizontal_lines(const cv::Mat& im, float line_density = 0.75f);
+	static std::vector<int> find_horizontal_lines(const cv::Mat& im, float line_density = 0.75f,
+		line_detection method = line_detection::HOUGH);
 
 	/*
 	* Iterates the rows of a table specified by horizontal lines
 	*/
-	static void iterate_rows(const cv::Mat& im,
+	void iterate_rows(const cv::Mat& im,
 		float line_density,
-		const std::function<void(const cv::Mat & row)> f);
+		const std::function<void(const cv::Mat & row)> f) const;
+
+	/*
+	* Returns the rows of a table specified by horizontal lines, top to bottom.
+	* The lines of a pane are reused on later frames while they pass the probes
+	* of row_grid_tracker.
+	*/
+	std::vector<cv::Mat> get_rows(const cv::Mat& im, float line_density) const;
+
+	/*
+	* Evaluates @param{f} for all rows of a table concurrently,
+	* the results are returned in the order of the rows.
+	* @param{f} must only use the thread safe methods of this class
+	* (recognition and matching, not the setters).
+	*/
+	template <typename T>
+	std::vector<T> map_rows(const cv::Mat& im,
+		float line_density,
+		const std::function<T(const cv::Mat& row)>& f) const
+	{
+		std::vector<cv::Mat> rows = get_rows(im, line_density);
+		std::vector<T> results(rows.size());
+		parallel_for(rows.size(), [&](std::size_t i) { results[i] = f(rows[i]); });
+		return results;
+	}
+
+	/*
+	* Calls @param{f} for 0, ..., @param{count} - 1 on all cores and waits for completion.
+	* Runs sequentially in verbose mode to keep the debug output readable
+	* and for less than MIN_PARALLEL_COUNT iterations.
+	*/
+	void parallel_for(std::size_t count, const std::function<void(std::size_t)>& f) const;
+
+	static const std::size_t MIN_PARALLEL_COUNT = 3;
 
 
 
 	/*
 	* Returns an integer contained in im.
+	* @param{characters} are the characters the text can contain, see digit_recognizer::recognize
 	* Returns MIN_INTEGER on failure
 	*/
-	int number_from_region(const cv::Mat& im);
+	int number_from_region(const cv::Mat& im, const std::string& characters = digit_recognizer::DIGITS);
+
+	/*
+	* Same as number_from_region for each image in @param{images}, uses batched OCR
+	*/
+	std::vector<int> numbers_from_regions(const std::vector<cv::Mat>& images, const std::string& characters = digit_recognizer::DIGITS);
+
+	/*
+	* Same as number_from_region for each rectangle in @param{cells} of @param{page},
+	* see detect_words_in_cells
+	*/
+	std::vector<int> numbers_from_cells(const cv::Mat& page, const std::vector<cv::Rect>& cells, const std::string& characters = digit_recognizer::DIGITS);
 
 	/*
 	* Parses the integer contained in @param{word}
@@ -346,6 +595,24 @@ public:
 	 */
 	std::pair<int, int> read_number_slash_number(const cv::Mat& im);
 
+	/**
+	 * Same as read_number_slash_number for each image in @param{images}, uses batched OCR
+	 * and falls back to read_number_slash_number if the batched result cannot be parsed
+	 */
+	std::vector<std::pair<int, int>> read_numbers_slash_numbers(const std::vector<cv::Mat>& images);
+
+	/**
+	 * Same as read_number_slash_number for each rectangle in @param{cells} of @param{page},
+	 * see detect_words_in_cells
+	 */
+	std::vector<std::pair<int, int>> read_numbers_slash_numbers(const cv::Mat& page, const std::vector<cv::Rect>& cells);
+
+	/*
+	* Reads numbers on binarized images without Tesseract,
+	* learns the glyphs from the numbers read by Tesseract
+	*/
+	digit_recognizer digits;
+
 	static const std::map<std::string, std::string>  letter_to_digit;
 	static const std::string ALL_ISLANDS;
 
@@ -357,10 +624,14 @@ public:
 	std::string window_regex;
 
 	std::map<std::string, keyword_dictionary> dictionaries;
+	// one matcher per dictionary in dictionaries
+	std::map<const std::map<unsigned int, std::string>*, text_matcher> text_matchers;
 	std::map<unsigned int, cv::Mat> product_icons;
 	std::map<unsigned int, cv::Mat> factory_icons;
 	std::map<unsigned int, cv::Mat> population_icons;
 	std::map<unsigned int, cv::Mat> session_icons;
+	std::map<unsigned int, std::vector<std::uint64_t>> session_silhouettes;
+	static const int SILHOUETTE_SIZE = 64;
 	std::map<unsigned int, unsigned int> factory_to_region;
 	std::map<unsigned int, unsigned int> session_to_region;
 	static const unsigned int REGION_META = 5000005;
@@ -369,8 +640,119 @@ public:
 	std::map<unsigned int, std::set<unsigned int>> trader_to_offerings;
 	std::map<unsigned int, item::ptr> items;
 	std::map<unsigned int, cv::Mat> item_backgrounds;
+	icon_hash_index item_hashes;
+	static const unsigned int ITEM_HASH_DISTANCE = 10;
 
 	static const std::map<std::string, std::string> tesseract_languages;
+
+private:
+	struct icon_atlas_key
+	{
+		cv::Size size;
+		int type;
+		std::uint64_t background_hash;
+
+		bool operator<(const icon_atlas_key& other) const;
+	};
+
+	// idle OCR engines per language
+	std::map<std::string, std::vector<std::unique_ptr<tesseract::TessBaseAPI>>> ocr_pool;
+	mutable std::mutex ocr_mutex;
+
+	/*
+	* Returns a new OCR engine for @param{language} or nullptr if the language is unknown
+	*/
+	std::unique_ptr<tesseract::TessBaseAPI> create_ocr(const std::string& language) const;
+
+	static const std::size_t OCR_BATCH_SIZE = 16;
+
+	/*
+	* Recognizes @param{images}[i] for all i in @param{members} in one page
+	* and writes the words to @param{result}[i]
+	*/
+	void detect_words_page(const std::vector<cv::Mat>& images,
+		const std::vector<std::size_t>& members,
+		std::vector<std::vector<std::pair<std::string, cv::Rect>>>& result);
+
+	/*
+	* Splits the words read from "amount / limit" into two number strings, empty on failure
+	*/
+	std::vector<std::string> split_number_slash_number(const std::vector<std::pair<std::string, cv::Rect>>& texts) const;
+	static std::vector<std::string> split_recognized_number_slash_number(const std::string& text);
+	static std::pair<int, int> parse_number_slash_number(std::vector<std::string> number_strings);
+
+	/*
+	* Collects the words found by the last Recognize call of @param{ocr},
+	* @param{origin} is subtracted from the bounding boxes
+	*/
+	static std::vector<std::pair<std::string, cv::Rect>> get_words(tesseract::TessBaseAPI& ocr, const cv::Point& origin = cv::Point());
+
+	/*
+	* Reads the numbers of @param{images}, @param{ocr} detects the words of the images
+	* with the passed indices which the glyph recognizer could not read.
+	* @param{cells} is true if @param{ocr} reads the images as cells of a page
+	* @param{characters} are the characters the images can contain
+	*/
+	std::vector<int> read_numbers(const std::vector<cv::Mat>& images,
+		const std::function<std::vector<std::vector<std::pair<std::string, cv::Rect>>>(const std::vector<std::size_t>&)>& ocr,
+		bool cells, const std::string& characters);
+
+	/*
+	* Scanline flood fill of the region of find_rgb_region on the BGRA image @param{input},
+	* calls @param{span} for each horizontal run [x_begin, x_end) of row y in the region
+	*/
+	static void fill_rgb_region(const cv::Mat& input, const cv::Point& seed, float threshold,
+		const std::function<void(int y, int x_begin, int x_end)>& span);
+
+	/*
+	* Keys of the result caches, @param{cell} separates reads of a cell of a page
+	* from reads of the cropped image
+	*/
+	std::uint64_t get_word_key(const cv::Mat& im, tesseract::PageSegMode mode, bool numbers_only, bool cell = false) const;
+	std::uint64_t get_number_key(const cv::Mat& im, bool cell = false) const;
+
+	static const std::size_t MAX_ICON_TEMPLATES = 16384;
+	static const std::size_t RESULT_CACHE_SIZE = 4096;
+
+	cv::Size resolution;
+	// screenshot height for geometry detection, 0 for the native resolution
+	int geometry_height = 0;
+	// shared, so that a scoring thread keeps its atlas if the atlases are dropped meanwhile
+	mutable std::map<icon_atlas_key, std::shared_ptr<icon_atlas>> icon_atlases;
+	// incremented whenever icon_atlases are dropped
+	mutable std::uint64_t icon_generation = 0;
+
+	// guards icon_atlases, icon_cache and icon_parity, shared while scoring against an atlas
+	mutable std::shared_mutex icon_mutex;
+	mutable parity_statistics icon_parity;
+	// guards word_cache, number_cache, digits, cell_parity and box_parity
+	mutable std::mutex cache_mutex;
+	bool parity_checks = false;
+	parity_statistics cell_parity;
+	mutable parity_statistics box_parity;
+
+	// recognition results keyed by the hash of the input pixels and all parameters
+	lru_cache<std::uint64_t, std::vector<std::pair<std::string, cv::Rect>>> word_cache{ RESULT_CACHE_SIZE };
+	lru_cache<std::uint64_t, int> number_cache{ RESULT_CACHE_SIZE };
+	// keys contain atlas slots, must be cleared together with icon_atlases
+	mutable lru_cache<std::uint64_t, std::vector<unsigned int>> icon_cache{ RESULT_CACHE_SIZE };
+	// separator lines of table panes, synchronized internally
+	mutable row_grid_tracker row_grids;
+	// fingerprints of menu titles, synchronized internally
+	screen_classifier screens;
+	// threads of parallel_for
+	mutable worker_pool workers;
+
+	/*
+	* Returns the atlas for templates of the given layout and background,
+	* drops all atlases if they hold too many templates
+	*/
+	std::shared_ptr<icon_atlas> get_icon_atlas(const cv::Size& size, int type, std::uint64_t background_hash) const;
+
+	/*
+	* Returns the slot of @param{icon} in @param{atlas}, blends and adds it if necessary
+	*/
+	std::size_t get_icon_slot(icon_atlas& atlas, const cv::Mat& icon, const cv::Mat& background) const;
 };
 
 }
\ No newline at end of file
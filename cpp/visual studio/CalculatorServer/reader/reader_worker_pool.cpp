@@ -0,0 +1,135 @@
+#include "reader_worker_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace reader
+{
+
+////////////////////////////////////////
+//
+// Class: worker_pool
+//
+////////////////////////////////////////
+
+worker_pool::worker_pool(std::size_t threads)
+	:
+	thread_count(threads ? threads : std::max(1u, std::thread::hardware_concurrency()) - 1),
+	stopping(false)
+{
+}
+
+worker_pool::~worker_pool()
+{
+	{
+		std::lock_guard<std::mutex> lock(tasks_mutex);
+		stopping = true;
+	}
+	tasks_available.notify_all();
+
+	for (std::thread& t : threads)
+		t.join();
+}
+
+void worker_pool::parallel_for(std::size_t count, const std::function<void(std::size_t)>& f)
+{
+	std::size_t helpers = std::min(thread_count, count ? count - 1 : 0);
+	if (!helpers)
+	{
+		for (std::size_t i = 0; i < count; i++)
+			f(i);
+		return;
+	}
+
+	std::call_once(started, [this]()
+		{
+			for (std::size_t i = 0; i < thread_count; i++)
+				threads.emplace_back(&worker_pool::run, this);
+		});
+
+	// outlives the call if a queued task starts after the loop finished
+	struct loop
+	{
+		std::atomic<std::size_t> next{ 0 };
+		std::mutex mutex;
+		std::condition_variable idle;
+		std::size_t running = 0;
+		bool finished = false;
+		std::exception_ptr error;
+	};
+	auto state = std::make_shared<loop>();
+
+	auto iterate = [state, count, &f]()
+	{
+		try {
+			for (std::size_t i = state->next++; i < count; i = state->next++)
+				f(i);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(state->mutex);
+			if (!state->error)
+				state->error = std::current_exception();
+			// skip the remaining iterations
+			state->next = count;
+		}
+	};
+
+	{
+		std::lock_guard<std::mutex> lock(tasks_mutex);
+		for (std::size_t i = 0; i < helpers; i++)
+			tasks.emplace_back([state, iterate]()
+				{
+					{
+						std::lock_guard<std::mutex> lock(state->mutex);
+						if (state->finished)
+							return;
+						state->running++;
+					}
+
+					iterate();
+
+					std::lock_guard<std::mutex> lock(state->mutex);
+					if (!--state->running)
+						state->idle.notify_all();
+				});
+	}
+	tasks_available.notify_all();
+
+	iterate();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished = true;
+	state->idle.wait(lock, [&state]() { return !state->running; });
+
+	if (state->error)
+		std::rethrow_exception(state->error);
+}
+
+std::size_t worker_pool::size() const
+{
+	return thread_count;
+}
+
+void worker_pool::run()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(tasks_mutex);
+			tasks_available.wait(lock, [this]() { return stopping || !tasks.empty(); });
+			if (stopping && tasks.empty())
+				return;
+
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+
+		task();
+	}
+}
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace reader
+{
+
+/*
+* A fixed set of threads that run the iterations of parallel_for calls.
+* The threads are started on the first call and live until the pool is destroyed,
+* so short loops do not pay for creating threads.
+*/
+class worker_pool
+{
+public:
+	/*
+	* @param{threads} number of worker threads, hardware concurrency - 1 if 0
+	*/
+	explicit worker_pool(std::size_t threads = 0);
+	~worker_pool();
+
+	worker_pool(const worker_pool&) = delete;
+	worker_pool& operator=(const worker_pool&) = delete;
+
+	/*
+	* Calls @param{f} for 0, ..., @param{count} - 1 on the calling thread and
+	* the workers and waits for completion. Rethrows the first exception of @param{f}.
+	* May be called from within @param{f}: the caller only waits for workers that
+	* already took part in the loop, queued tasks of a finished loop return at once.
+	*/
+	void parallel_for(std::size_t count, const std::function<void(std::size_t)>& f);
+
+	std::size_t size() const;
+
+private:
+	std::size_t thread_count;
+	std::vector<std::thread> threads;
+	std::once_flag started;
+
+	std::mutex tasks_mutex;
+	std::condition_variable tasks_available;
+	std::deque<std::function<void()>> tasks;
+	bool stopping;
+
+	void run();
+};
+
+}
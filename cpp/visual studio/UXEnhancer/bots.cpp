@@ -77,7 +77,7 @@ reroll_bot::reroll_bot(configuration& config, reader::image_recognition& recog,
 execution_result reroll_bot::execute_step(bool update_required)
 {
 	if(update_required)
-		reader.update(config.get_language(), take_screenshot());
+		reader.update(config.get_language(), take_stable_screenshot());
 
 	unsigned int trader = reader.get_open_trader();
 
@@ -190,7 +190,7 @@ execution_result reroll_bot::execute_step(bool update_required)
 				auto purchase_iter = purchase_candidates.begin();
 				for (; purchase_iter != purchase_candidates.end(); ++purchase_iter)
 				{
-					reader.update(config.get_language(), take_screenshot());
+					reader.update(config.get_language(), take_stable_screenshot());
 					if (reader.is_ship_full())
 					{
 						if (verbose)
@@ -206,8 +206,7 @@ execution_result reroll_bot::execute_step(bool update_required)
 				do
 				{
 					System::Threading::Thread::Sleep(TimeSpan::FromMilliseconds(300));
-					cv::Mat screenshot = take_screenshot();
-					reader.update(config.get_language(), screenshot);
+					reader.update(config.get_language(), take_stable_screenshot());
 
 					if (verbose)
 						std::cout << get_time_str() << "try executing trade (" << exceute_check_count << ")" << std::endl;
@@ -274,6 +273,18 @@ execution_result reroll_bot::execute_step(bool update_required)
 	return execution_result(std::chrono::seconds(1));
 }
 
+reader::frame::ptr reroll_bot::take_stable_screenshot()
+{
+	// skips the frames while the menu opens or the offerings render in
+	reader::frame::ptr screenshot = reader::frame::create(take_screenshot());
+	for (int i = 1; i < reader::stability_gate::MAX_CAPTURES && !reader.is_stable(config.get_language(), screenshot); i++)
+	{
+		System::Threading::Thread::Sleep(TimeSpan::FromMilliseconds(reader::stability_gate::CAPTURE_INTERVAL_MS));
+		screenshot = reader::frame::create(take_screenshot());
+	}
+	return screenshot;
+}
+
 std::string reroll_bot::get_time_str() const
 {
 	boost::posix_time::ptime time = boost::posix_time::microsec_clock::local_time();
@@ -55,4 +55,10 @@ private:
 	int counter = 0;
 
 	std::string get_time_str() const;
+
+	/*
+	* Captures until the trading menu is not animated,
+	* at most reader::stability_gate::MAX_CAPTURES times
+	*/
+	reader::frame::ptr take_stable_screenshot();
 };
\ No newline at end of file